@@ -0,0 +1,243 @@
+import os
+import sys
+import json
+import mmap
+import fcntl
+import struct
+import hashlib
+import threading
+import workers
+
+# incremental quota accounting: per-user stored-byte and transfer
+# counters are updated at STOR/DELE time, so the quota check at upload
+# start is a table lookup instead of the nightly cron walk over /home.
+# The live counters sit in a memory-mapped slot table shared by every
+# process that opens the same ledger (prefork workers, both server
+# instances), guarded by a flock like the shared.py board — a per-worker
+# in-memory dict would fragment the totals and enforce quotas per worker.
+# The json file is a periodic snapshot of the table, used to reseed it
+# when it doesn't exist yet; counter drift (e.g. files changed outside
+# FTP) is repaired with the --reconcile bootstrap pass:
+#   python3 accounting.py <ledger> --reconcile <user> <homedir>
+
+FLUSH_EVERY = 5.0
+MAGIC = b'FTPQ'
+SLOTS = 4096
+NAME_LEN = 32
+SLOT_FMT = '<%dsQQQ' % NAME_LEN   # name, stored, uploaded, downloaded
+SLOT_SIZE = struct.calcsize(SLOT_FMT)
+HEADER_FMT = '<4sI'               # magic, slot count
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+
+class Ledger:
+    def __init__(self, path):
+        self.path = path
+        self.quotas = {}  # username -> stored-bytes limit
+        self._lock = threading.Lock()
+        size = HEADER_SIZE + SLOTS * SLOT_SIZE
+        self._fd = os.open(path + '.shm', os.O_RDWR | os.O_CREAT, 0o600)
+        os.ftruncate(self._fd, size)
+        self._mm = mmap.mmap(self._fd, size)
+        self._attach()
+        # the flusher would not survive the prefork in workers.py; each
+        # serving process starts its own (the --reconcile CLI path never
+        # needs one since set_stored flushes synchronously).  Concurrent
+        # flushers are harmless: each snapshots the same shared table
+        workers.postfork(self._start_flusher)
+
+    def _start_flusher(self):
+        threading.Thread(target=self._flusher, daemon=True).start()
+
+    def _locked(method):
+        def wrapper(self, *args, **kwargs):
+            with self._lock:
+                fcntl.flock(self._fd, fcntl.LOCK_EX)
+                try:
+                    return method(self, *args, **kwargs)
+                finally:
+                    fcntl.flock(self._fd, fcntl.LOCK_UN)
+        return wrapper
+
+    def _slot(self, username):
+        raw = username.encode('utf8')[:NAME_LEN]
+        digest = hashlib.sha1(raw).digest()
+        base = int.from_bytes(digest[:4], 'little') % SLOTS
+        for probe in range(SLOTS):
+            off = HEADER_SIZE + ((base + probe) % SLOTS) * SLOT_SIZE
+            name = struct.unpack_from('<%ds' % NAME_LEN, self._mm, off)[0]
+            name = name.rstrip(b'\0')
+            if name == raw:
+                return off
+            if not name:
+                struct.pack_into('<%ds' % NAME_LEN, self._mm, off, raw)
+                return off
+        return None
+
+    @_locked
+    def _attach(self):
+        # first process to map a fresh (or reformatted) table seeds it
+        # from the last json snapshot; later attachers see the magic and
+        # join the live counters as they are
+        magic, slots = struct.unpack_from(HEADER_FMT, self._mm, 0)
+        if magic == MAGIC and slots == SLOTS:
+            return
+        struct.pack_into(HEADER_FMT, self._mm, 0, MAGIC, SLOTS)
+        try:
+            with open(self.path) as f:
+                users = json.load(f).get('users', {})
+        except (OSError, ValueError):
+            return
+        for username, rec in users.items():
+            off = self._slot(username)
+            if off is None:
+                continue
+            name = struct.unpack_from('<%ds' % NAME_LEN, self._mm, off)[0]
+            struct.pack_into(SLOT_FMT, self._mm, off, name,
+                             max(0, int(rec.get('stored', 0))),
+                             int(rec.get('uploaded', 0)),
+                             int(rec.get('downloaded', 0)))
+
+    @_locked
+    def add_stored(self, username, delta):
+        off = self._slot(username)
+        if off is None:
+            return
+        name, stored, up, down = struct.unpack_from(SLOT_FMT, self._mm, off)
+        struct.pack_into(SLOT_FMT, self._mm, off, name,
+                         max(0, stored + delta), up, down)
+
+    @_locked
+    def add_transfer(self, username, uploaded=0, downloaded=0):
+        off = self._slot(username)
+        if off is None:
+            return
+        name, stored, up, down = struct.unpack_from(SLOT_FMT, self._mm, off)
+        struct.pack_into(SLOT_FMT, self._mm, off, name, stored,
+                         up + uploaded, down + downloaded)
+
+    @_locked
+    def stored(self, username):
+        off = self._slot(username)
+        if off is None:
+            return 0
+        return struct.unpack_from(SLOT_FMT, self._mm, off)[1]
+
+    def over_quota(self, username):
+        limit = self.quotas.get(username)
+        return limit is not None and self.stored(username) >= limit
+
+    @_locked
+    def set_stored(self, username, value):
+        off = self._slot(username)
+        if off is None:
+            return
+        name, stored, up, down = struct.unpack_from(SLOT_FMT, self._mm, off)
+        struct.pack_into(SLOT_FMT, self._mm, off, name, value, up, down)
+
+    @_locked
+    def _snapshot(self):
+        users = {}
+        for i in range(SLOTS):
+            off = HEADER_SIZE + i * SLOT_SIZE
+            name, stored, up, down = struct.unpack_from(SLOT_FMT,
+                                                        self._mm, off)
+            name = name.rstrip(b'\0')
+            if name:
+                users[name.decode('utf8', 'replace')] = {
+                    'stored': stored, 'uploaded': up, 'downloaded': down}
+        return users
+
+    def flush(self):
+        payload = json.dumps({'users': self._snapshot()})
+        tmp = self.path + '.tmp'
+        try:
+            with open(tmp, 'w') as f:
+                f.write(payload)
+            os.replace(tmp, self.path)
+        except OSError:
+            pass
+
+    def _flusher(self):
+        import time
+        while True:
+            time.sleep(FLUSH_EVERY)
+            self.flush()
+
+def reconcile(ledger, username, homedir):
+    total = 0
+    for dirpath, dirnames, filenames in os.walk(homedir):
+        for name in filenames:
+            try:
+                total += os.path.getsize(os.path.join(dirpath, name))
+            except OSError:
+                pass
+    ledger.set_stored(username, total)
+    ledger.flush()
+    return total
+
+class QuotaFTPHandlerMixin:
+    ledger = None
+
+    def ftp_STOR(self, file, mode='w'):
+        if self.ledger.over_quota(self.username):
+            self.respond('552 Storage quota exceeded.')
+            return
+        # remember what the target held before the upload opens it, so the
+        # completion hook can account the delta instead of the full size
+        # (an overwrite replaces those bytes, an append keeps them)
+        try:
+            self._stor_prev_size = os.path.getsize(file)
+        except OSError:
+            self._stor_prev_size = 0
+        return super().ftp_STOR(file, mode)
+
+class AccountingFSMixin:
+    ledger = None
+
+    def remove(self, path):
+        try:
+            size = os.path.getsize(path)
+        except OSError:
+            size = 0
+        super().remove(path)
+        if size:
+            self.ledger.add_stored(self.cmd_channel.username, -size)
+
+def enable(handler, path):
+    ledger = Ledger(path)
+    handler.abstracted_fs = type('AccountingFS',
+                                 (AccountingFSMixin,
+                                  handler.abstracted_fs),
+                                 {'ledger': ledger})
+    previous_recv = handler.on_file_received
+    def on_file_received(self, file):
+        previous_recv(self, file)
+        try:
+            size = os.path.getsize(file)
+        except OSError:
+            size = 0
+        prev = getattr(self, '_stor_prev_size', 0)
+        self._stor_prev_size = 0
+        ledger.add_stored(self.username, size - prev)
+        ledger.add_transfer(self.username, uploaded=size)
+    handler.on_file_received = on_file_received
+    previous_sent = handler.on_file_sent
+    def on_file_sent(self, file):
+        previous_sent(self, file)
+        try:
+            ledger.add_transfer(self.username,
+                                downloaded=os.path.getsize(file))
+        except OSError:
+            pass
+    handler.on_file_sent = on_file_sent
+    return ledger, type('QuotaFTPHandler', (QuotaFTPHandlerMixin, handler),
+                        {'ledger': ledger})
+
+if __name__ == '__main__':
+    if len(sys.argv) == 5 and sys.argv[2] == '--reconcile':
+        ledger = Ledger(sys.argv[1])
+        total = reconcile(ledger, sys.argv[3], sys.argv[4])
+        print('%s: %d bytes stored' % (sys.argv[3], total))
+    else:
+        raise SystemExit(
+            'usage: accounting.py <ledger> --reconcile <user> <homedir>')
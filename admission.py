@@ -0,0 +1,87 @@
+import threading
+from pyftpdlib.servers import FTPServer
+
+import metrics
+import shaper
+
+# admission control ahead of the session machinery: connections are
+# vetted in handle_accepted, before a handler (and under TLS a handshake)
+# is spun up, against a global session ceiling, a per-source session
+# ceiling, a per-source connect-rate bucket, and the measured event-loop
+# lag — when the loop is already drowning we close the socket outright
+# rather than degrade every established session together
+
+MAX_SESSIONS = 2000
+PER_SOURCE = 64
+SOURCE_RATE = 20      # connects/sec per source ip
+SOURCE_BURST = 40
+LAG_SHED = 0.5        # seconds of loop lag at which new connections shed
+
+class Controller:
+    def __init__(self, max_sessions=MAX_SESSIONS, per_source=PER_SOURCE,
+                 source_rate=SOURCE_RATE, source_burst=SOURCE_BURST,
+                 lag_shed=LAG_SHED):
+        self.max_sessions = max_sessions
+        self.per_source = per_source
+        self.source_rate = source_rate
+        self.source_burst = source_burst
+        self.lag_shed = lag_shed
+        self._sessions = {}  # ip -> active count
+        self._buckets = {}   # ip -> connect-rate bucket
+        self._total = 0
+        self._lock = threading.Lock()
+        self.rejected = 0
+
+    def admit(self, ip):
+        if metrics.stats.event_loop_lag_s > self.lag_shed:
+            self.rejected += 1
+            return False
+        with self._lock:
+            if self._total >= self.max_sessions or \
+                    self._sessions.get(ip, 0) >= self.per_source:
+                self.rejected += 1
+                return False
+            bucket = self._buckets.get(ip)
+            if bucket is None:
+                bucket = self._buckets[ip] = shaper.TokenBucket(
+                    self.source_rate, self.source_burst)
+            if bucket.grant(1) < 1:
+                self.rejected += 1
+                return False
+            self._sessions[ip] = self._sessions.get(ip, 0) + 1
+            self._total += 1
+            return True
+
+    def released(self, ip):
+        with self._lock:
+            count = self._sessions.get(ip, 0) - 1
+            if count <= 0:
+                self._sessions.pop(ip, None)
+                self._buckets.pop(ip, None)
+            else:
+                self._sessions[ip] = count
+            self._total = max(0, self._total - 1)
+
+class AdmissionFTPServer(FTPServer):
+    controller = None
+
+    def handle_accepted(self, sock, addr):
+        if addr is not None and not self.controller.admit(addr[0]):
+            try:
+                sock.close()
+            except OSError:
+                pass
+            return
+        return super().handle_accepted(sock, addr)
+
+def enable(handler, **limits):
+    controller = Controller(**limits)
+    previous = handler.on_disconnect
+    def on_disconnect(self):
+        if self.remote_ip:
+            controller.released(self.remote_ip)
+        previous(self)
+    handler.on_disconnect = on_disconnect
+    server_class = type('AdmissionFTPServer', (AdmissionFTPServer,),
+                        {'controller': controller})
+    return controller, server_class
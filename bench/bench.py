@@ -0,0 +1,136 @@
+#!/usr/bin/python3
+import os
+import sys
+import json
+import time
+import ftplib
+import subprocess
+import statistics
+import tempfile
+import io
+
+# loopback benchmark for the two server configurations: launches sslftp.py
+# and windows.py exactly as r.sh does, drives them with a client swarm and
+# prints machine-readable JSON so runs can be diffed across pyftpdlib
+# upgrades or config changes
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+USER, PASS = 'wangyifan', 'helloUSA'
+CONNECTS = 50
+SMALL_FILES = 200
+SMALL_SIZE = 16 * 1024
+LARGE_SIZE = 256 * 1024 * 1024
+
+def percentiles(samples):
+    samples = sorted(samples)
+    def pct(p):
+        return samples[min(len(samples) - 1, int(len(samples) * p))]
+    return {'p50': pct(0.50), 'p95': pct(0.95), 'p99': pct(0.99),
+            'mean': statistics.fmean(samples)}
+
+def connect(port, tls):
+    if tls:
+        ftp = ftplib.FTP_TLS()
+        ftp.connect('127.0.0.1', port, timeout=30)
+        ftp.login(USER, PASS)
+        ftp.prot_p()
+    else:
+        ftp = ftplib.FTP()
+        ftp.connect('127.0.0.1', port, timeout=30)
+        ftp.login(USER, PASS)
+    return ftp
+
+def bench_connects(port, tls):
+    lat = []
+    t0 = time.monotonic()
+    for _ in range(CONNECTS):
+        t = time.monotonic()
+        ftp = connect(port, tls)
+        lat.append(time.monotonic() - t)
+        ftp.quit()
+    wall = time.monotonic() - t0
+    return {'connects_per_sec': CONNECTS / wall,
+            'handshake_latency_s': percentiles(lat)}
+
+def bench_transfers(port, tls, workdir):
+    ftp = connect(port, tls)
+    out = {}
+    small = os.urandom(SMALL_SIZE)
+    t0 = time.monotonic()
+    for i in range(SMALL_FILES):
+        ftp.storbinary('STOR %s/bench-small-%d' % (workdir, i),
+                       io.BytesIO(small))
+    out['stor_small_mb_s'] = \
+        SMALL_FILES * SMALL_SIZE / (time.monotonic() - t0) / 1e6
+    t0 = time.monotonic()
+    for i in range(SMALL_FILES):
+        ftp.retrbinary('RETR %s/bench-small-%d' % (workdir, i),
+                       lambda chunk: None)
+    out['retr_small_mb_s'] = \
+        SMALL_FILES * SMALL_SIZE / (time.monotonic() - t0) / 1e6
+    big = io.BytesIO(os.urandom(1024 * 1024))
+    class Repeat(io.RawIOBase):
+        left = LARGE_SIZE
+        def read(self, n=-1):
+            if self.left <= 0:
+                return b''
+            big.seek(0)
+            data = big.read(min(self.left, 1024 * 1024))
+            self.left -= len(data)
+            return data
+    t0 = time.monotonic()
+    ftp.storbinary('STOR %s/bench-large' % workdir, Repeat())
+    out['stor_large_mb_s'] = LARGE_SIZE / (time.monotonic() - t0) / 1e6
+    t0 = time.monotonic()
+    ftp.retrbinary('RETR %s/bench-large' % workdir, lambda chunk: None)
+    out['retr_large_mb_s'] = LARGE_SIZE / (time.monotonic() - t0) / 1e6
+    lat = []
+    for _ in range(20):
+        t = time.monotonic()
+        ftp.retrlines('LIST %s' % workdir, lambda line: None)
+        lat.append(time.monotonic() - t)
+    out['list_latency_s'] = percentiles(lat)
+    for i in range(SMALL_FILES):
+        ftp.delete('%s/bench-small-%d' % (workdir, i))
+    ftp.delete('%s/bench-large' % workdir)
+    ftp.quit()
+    return out
+
+def bench_server(script, port, tls):
+    proc = subprocess.Popen([sys.executable, os.path.join(ROOT, script)],
+                            cwd=ROOT, stdout=subprocess.DEVNULL,
+                            stderr=subprocess.DEVNULL)
+    try:
+        for _ in range(100):
+            try:
+                connect(port, tls).quit()
+                break
+            except ftplib.all_errors:
+                # covers both "not listening yet" (OSError) and the 431
+                # the server answers while its TLS context is still building
+                time.sleep(0.1)
+        else:
+            return {'error': '%s did not come up on %d' % (script, port)}
+        result = {'connects': bench_connects(port, tls)}
+        # the benched user's home is '..' relative to the repo, so stage
+        # bench files in a tempdir directly under that root
+        with tempfile.TemporaryDirectory(dir=os.path.dirname(ROOT)) as tmp:
+            result['transfers'] = bench_transfers(
+                port, tls, os.path.basename(tmp))
+        return result
+    finally:
+        proc.terminate()
+        proc.wait()
+
+def main():
+    report = {
+        'timestamp': time.time(),
+        'sslftp': bench_server('sslftp.py', 2121, tls=True),
+    }
+    if os.geteuid() == 0:  # windows.py binds port 21
+        report['windows'] = bench_server('windows.py', 21, tls=False)
+    json.dump(report, sys.stdout, indent=2)
+    print()
+
+if __name__ == '__main__':
+    main()
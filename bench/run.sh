@@ -0,0 +1,4 @@
+#!/bin/bash
+# run the loopback benchmark and keep a dated JSON result for diffing
+cd "$(dirname "$0")"
+python3 bench.py | tee "result-$(date +%Y%m%d-%H%M%S).json"
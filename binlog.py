@@ -0,0 +1,149 @@
+import os
+import sys
+import json
+import mmap
+import time
+import struct
+import threading
+from collections import deque
+import workers
+
+# transfer log that stays off the data path: hot-path hooks append a
+# tuple to an in-memory deque and return; a background thread packs them
+# into fixed 128-byte records in a memory-mapped ring file and flushes in
+# batches.  Line logging was too slow to leave on at 5k transfers/sec,
+# which is why r.sh throws stdout away; this one is cheap enough to keep.
+# "python3 binlog.py <ringfile>" dumps the records as JSON lines
+
+MAGIC = b'FTPL'
+RECORD_FMT = '<dQdBB32s70s'  # ts, bytes, duration, tls, dir, user, path
+RECORD_SIZE = struct.calcsize(RECORD_FMT)
+HEADER_FMT = '<4sIIQ'        # magic, record_size, capacity, next index
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+CAPACITY = 65536             # records in the ring (~8MB)
+FLUSH_EVERY = 0.5
+
+DIR_IN, DIR_OUT = 0, 1
+
+class RingLog:
+    def __init__(self, path, capacity=CAPACITY):
+        size = HEADER_SIZE + capacity * RECORD_SIZE
+        fd = os.open(path, os.O_RDWR | os.O_CREAT, 0o600)
+        try:
+            os.ftruncate(fd, size)
+            self._mm = mmap.mmap(fd, size)
+        finally:
+            os.close(fd)
+        self._capacity = capacity
+        magic, rsize, cap, index = struct.unpack_from(HEADER_FMT,
+                                                      self._mm, 0)
+        if magic == MAGIC and rsize == RECORD_SIZE and cap == capacity:
+            self._index = index
+        else:
+            self._index = 0
+            struct.pack_into(HEADER_FMT, self._mm, 0, MAGIC, RECORD_SIZE,
+                             capacity, 0)
+        self._queue = deque()
+        self._event = threading.Event()
+        self._writer_thread = None
+
+    def start(self):
+        if self._writer_thread is None or not self._writer_thread.is_alive():
+            self._writer_thread = threading.Thread(target=self._writer,
+                                                   daemon=True)
+            self._writer_thread.start()
+
+    def record(self, nbytes, duration, tls, direction, user, path):
+        # deque.append only; everything else happens on the writer thread
+        if self._writer_thread is None:
+            self.start()
+        self._queue.append((time.time(), nbytes, duration, tls, direction,
+                            user or '', path or ''))
+        self._event.set()
+
+    def _writer(self):
+        while True:
+            self._event.wait()
+            self._event.clear()
+            wrote = False
+            while self._queue:
+                ts, nbytes, duration, tls, direction, user, path = \
+                    self._queue.popleft()
+                off = HEADER_SIZE + \
+                    (self._index % self._capacity) * RECORD_SIZE
+                struct.pack_into(RECORD_FMT, self._mm, off, ts, nbytes,
+                                 duration, 1 if tls else 0, direction,
+                                 user.encode('utf8', 'replace')[:32],
+                                 path.encode('utf8', 'replace')[-70:])
+                self._index += 1
+                wrote = True
+            if wrote:
+                struct.pack_into(HEADER_FMT, self._mm, 0, MAGIC,
+                                 RECORD_SIZE, self._capacity, self._index)
+                self._mm.flush()
+            time.sleep(FLUSH_EVERY)
+
+def _transfer(handler, direction):
+    dc = handler.data_channel
+    if dc is not None:
+        nbytes = dc.tot_bytes_sent if direction == DIR_OUT \
+            else dc.tot_bytes_received
+        duration = dc.get_elapsed_time()
+    else:
+        nbytes, duration = 0, 0.0
+    return nbytes, duration
+
+def enable(handler, path):
+    # the ring is mmap'd, so a single file shared across prefork workers
+    # would interleave siblings' private _index counters and overwrite
+    # records; each serving process maps its own pid-suffixed ring (like
+    # the metrics socket) and the writer thread starts with it
+    state = {'log': None}
+    master_pid = os.getpid()
+    def start():
+        ring = path if os.getpid() == master_pid \
+            else '%s.%d' % (path, os.getpid())
+        state['log'] = RingLog(ring)
+        state['log'].start()
+    workers.postfork(start)
+    def hook(direction, previous):
+        def on_file(self, file):
+            log = state['log']
+            if log is not None:
+                nbytes, duration = _transfer(self, direction)
+                log.record(nbytes, duration,
+                           bool(getattr(self, '_prot', False)), direction,
+                           self.username, file)
+            previous(self, file)
+        return on_file
+    handler.on_file_sent = hook(DIR_OUT, handler.on_file_sent)
+    handler.on_file_received = hook(DIR_IN, handler.on_file_received)
+    handler.on_incomplete_file_received = \
+        hook(DIR_IN, handler.on_incomplete_file_received)
+
+def dump(path, out=sys.stdout):
+    with open(path, 'rb') as f:
+        head = f.read(HEADER_SIZE)
+        magic, rsize, capacity, index = struct.unpack(HEADER_FMT, head)
+        if magic != MAGIC or rsize != RECORD_SIZE:
+            raise SystemExit('%s: not a transfer ring log' % path)
+        start = max(0, index - capacity)
+        for i in range(start, index):
+            f.seek(HEADER_SIZE + (i % capacity) * RECORD_SIZE)
+            ts, nbytes, duration, tls, direction, user, rpath = \
+                struct.unpack(RECORD_FMT, f.read(RECORD_SIZE))
+            json.dump({
+                'time': ts,
+                'bytes': nbytes,
+                'duration_s': duration,
+                'tls': bool(tls),
+                'direction': 'in' if direction == DIR_IN else 'out',
+                'user': user.rstrip(b'\0').decode('utf8', 'replace'),
+                'path': rpath.rstrip(b'\0').decode('utf8', 'replace'),
+            }, out)
+            out.write('\n')
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        raise SystemExit('usage: binlog.py <ringfile>')
+    dump(sys.argv[1])
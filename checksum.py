@@ -0,0 +1,134 @@
+import os
+import zlib
+import hashlib
+import threading
+from collections import OrderedDict
+
+# upload verification without the extra read: digests are computed
+# incrementally as STOR bytes arrive and cached keyed by path+mtime, so
+# XCRC/XMD5/XSHA256 right after an upload is a dict lookup instead of a
+# full re-read of the file.  Cold queries fall back to hashing the file
+
+CACHE_MAX = 4096
+
+class DigestCache:
+    def __init__(self):
+        self._entries = OrderedDict()  # path -> (mtime, size, digests)
+        self._lock = threading.Lock()
+
+    def get(self, path):
+        try:
+            st = os.stat(path)
+        except OSError:
+            return None
+        with self._lock:
+            entry = self._entries.get(path)
+            if entry and entry[0] == st.st_mtime and entry[1] == st.st_size:
+                self._entries.move_to_end(path)
+                return entry[2]
+        return None
+
+    def put(self, path, digests):
+        try:
+            st = os.stat(path)
+        except OSError:
+            return
+        with self._lock:
+            self._entries[path] = (st.st_mtime, st.st_size, digests)
+            self._entries.move_to_end(path)
+            while len(self._entries) > CACHE_MAX:
+                self._entries.popitem(last=False)
+
+cache = DigestCache()
+
+def _digests(crc, md5, sha256):
+    return {'XCRC': '%08X' % (crc & 0xffffffff),
+            'XMD5': md5.hexdigest().upper(),
+            'XSHA256': sha256.hexdigest().upper()}
+
+def hash_file(path):
+    crc, md5, sha256 = 0, hashlib.md5(), hashlib.sha256()
+    with open(path, 'rb') as f:
+        for chunk in iter(lambda: f.read(1024 * 1024), b''):
+            crc = zlib.crc32(chunk, crc)
+            md5.update(chunk)
+            sha256.update(chunk)
+    return _digests(crc, md5, sha256)
+
+class HashingWriter:
+    def __init__(self, fh, path):
+        self._fh = fh
+        self._path = path
+        self.name = getattr(fh, 'name', path)
+        self.closed = False
+        self._crc = 0
+        self._md5 = hashlib.md5()
+        self._sha256 = hashlib.sha256()
+        self._tainted = False  # seek invalidates the running digests
+
+    def write(self, data):
+        if not self._tainted:
+            self._crc = zlib.crc32(data, self._crc)
+            self._md5.update(data)
+            self._sha256.update(data)
+        return self._fh.write(data)
+
+    def seek(self, offset, whence=0):
+        self._tainted = True
+        self._fh.seek(offset, whence)
+
+    def close(self):
+        if self.closed:
+            return
+        self._fh.close()
+        self.closed = True
+        if not self._tainted:
+            cache.put(self._path, _digests(self._crc, self._md5,
+                                           self._sha256))
+
+    def __getattr__(self, name):
+        return getattr(self._fh, name)
+
+class HashFSMixin:
+    def open(self, filename, mode):
+        fh = super().open(filename, mode)
+        if 'w' in mode and '+' not in mode:
+            return HashingWriter(fh, filename)
+        return fh
+
+class ChecksumFTPHandlerMixin:
+    def _ftp_digest(self, path, kind):
+        # the dispatcher already translated the argument (perm='r'), so
+        # path is a real filesystem path here, like ftp_RETR's
+        if not self.fs.isfile(path):
+            self.respond('550 %s is not a file.' % self.fs.fs2ftp(path))
+            return
+        digests = cache.get(path)
+        if digests is None:
+            try:
+                digests = hash_file(path)
+            except OSError as err:
+                self.respond('550 %s.' % err.strerror)
+                return
+            cache.put(path, digests)
+        self.respond('250 %s' % digests[kind])
+
+    def ftp_XCRC(self, line):
+        self._ftp_digest(line, 'XCRC')
+
+    def ftp_XMD5(self, line):
+        self._ftp_digest(line, 'XMD5')
+
+    def ftp_XSHA256(self, line):
+        self._ftp_digest(line, 'XSHA256')
+
+def enable(handler):
+    handler.abstracted_fs = type('HashFS',
+                                 (HashFSMixin, handler.abstracted_fs), {})
+    proto_cmds = dict(handler.proto_cmds)
+    for cmd in ('XCRC', 'XMD5', 'XSHA256'):
+        proto_cmds[cmd] = dict(
+            perm='r', auth=True, arg=True,
+            help='Syntax: %s <SP> file-name (report file digest).' % cmd)
+    return type('ChecksumFTPHandler', (ChecksumFTPHandlerMixin, handler),
+                {'proto_cmds': proto_cmds})
@@ -0,0 +1,29 @@
+from pyftpdlib import ioloop
+
+# event-engine selection: one poller syscall per loop iteration returns
+# the whole batch of ready sockets, so at 5k connections the per-socket
+# syscall overhead comes from the backend choice.  There is no stdlib
+# io_uring binding, so epoll (with everything reaped in one wait) is the
+# batched engine on Linux; kqueue covers the BSDs and poll/select remain
+# as fallbacks.  Selection happens before the singleton loop is built so
+# every module shares the chosen backend
+
+_BACKENDS = {
+    'epoll': getattr(ioloop, 'Epoll', None),
+    'kqueue': getattr(ioloop, 'Kqueue', None),
+    'poll': getattr(ioloop, 'Poll', None),
+    'select': getattr(ioloop, 'Select', None),
+}
+
+def enable(kind=None):
+    if not kind:
+        return ioloop.IOLoop.instance()
+    cls = _BACKENDS.get(kind)
+    if cls is None:
+        raise ValueError('unknown or unavailable event engine: %r' % kind)
+    instance = cls()
+    # install as the shared singleton regardless of which class callers
+    # reach instance() through
+    ioloop.IOLoop._instance = instance
+    cls._instance = instance
+    return instance
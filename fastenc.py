@@ -0,0 +1,41 @@
+import codecs
+
+# encoding fast path: handler.encoding = 'gbk' pushes every path and
+# listing line through the gbk charmap even though almost all names are
+# pure ASCII.  We register a wrapping codec that encodes/decodes ASCII
+# directly, and memoizes the gbk-encoded form of the non-ASCII names so
+# repeated listings of the same directory never re-run the codec
+
+CACHE_MAX = 65536
+
+def register(base='gbk'):
+    # normalized form: codec lookup lowercases and underscores the name
+    name = ('%s_fast' % base).replace('-', '_').lower()
+    encode_cache = {}
+
+    def encode(text, errors='strict'):
+        if text.isascii():
+            return text.encode('ascii'), len(text)
+        cached = encode_cache.get(text)
+        if cached is None:
+            cached = codecs.encode(text, base, errors)
+            if len(encode_cache) >= CACHE_MAX:
+                encode_cache.clear()
+            encode_cache[text] = cached
+        return cached, len(text)
+
+    def decode(data, errors='strict'):
+        data = bytes(data)
+        if data.isascii():
+            return data.decode('ascii'), len(data)
+        return codecs.decode(data, base, errors), len(data)
+
+    info = codecs.CodecInfo(encode, decode, name=name)
+
+    def search(codec_name):
+        if codec_name == name:
+            return info
+        return None
+
+    codecs.register(search)
+    return name
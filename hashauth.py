@@ -0,0 +1,121 @@
+import os
+import mmap
+import hmac
+import hashlib
+import threading
+from pyftpdlib.authorizers import DummyAuthorizer, AuthenticationFailed
+import workers
+
+# file-backed authorizer with hashed credentials: drops in where
+# DummyAuthorizer sits, but passwords are salted PBKDF2 digests instead of
+# plaintext and tens of thousands of users can live in an external db file
+# (one "name:salt_hex:digest_hex:home:perm" line per user).  The db is
+# memory-mapped and indexed by a background thread so startup never blocks
+# on reading it; until the index is ready lookups scan the map directly
+
+ITERATIONS = 100000
+
+def _digest(password, salt):
+    return hashlib.pbkdf2_hmac('sha256', password.encode('utf8'), salt,
+                               ITERATIONS)
+
+class HashedAuthorizer(DummyAuthorizer):
+    def __init__(self, users_file=None):
+        super().__init__()
+        self._hashes = {}  # username -> (salt, digest)
+        self._fast = {}    # username -> keyed HMAC of the credentials
+        self._fast_key = os.urandom(32)  # per-process, never stored
+        self._mm = None
+        self._indexed = threading.Event()
+        if users_file and os.path.exists(users_file):
+            fd = os.open(users_file, os.O_RDONLY)
+            try:
+                self._mm = mmap.mmap(fd, 0, prot=mmap.PROT_READ)
+            finally:
+                os.close(fd)
+            # indexing owns a thread, which would not survive the prefork
+            # in workers.py; each serving process indexes for itself and
+            # lookups scan the map directly until it finishes
+            workers.postfork(self._start_index)
+        else:
+            self._indexed.set()
+
+    def _start_index(self):
+        if not self._indexed.is_set():
+            threading.Thread(target=self._build_index, daemon=True).start()
+
+    def add_user(self, username, password, homedir, perm='elr', **kwargs):
+        salt = os.urandom(16)
+        self._hashes[username] = (salt, _digest(password, salt))
+        super().add_user(username, '', homedir, perm, **kwargs)
+
+    def validate_authentication(self, username, password, handler):
+        # the full PBKDF2 stretch takes tens of ms and runs on the event
+        # loop, so repeat logins (mirror jobs reconnect constantly) verify
+        # against a single keyed HMAC of the credentials cached after the
+        # first success; the key is random per process, so the cache leaks
+        # nothing the db doesn't
+        tag = hmac.new(self._fast_key,
+                       username.encode('utf8') + b'\0' +
+                       password.encode('utf8'), hashlib.sha256).digest()
+        cached = self._fast.get(username)
+        if cached is not None and hmac.compare_digest(cached, tag):
+            return
+        if username not in self._hashes and self._mm is not None:
+            self._load_record(username)
+        cred = self._hashes.get(username)
+        if cred is None:
+            raise AuthenticationFailed('Authentication failed.')
+        salt, want = cred
+        if not hmac.compare_digest(_digest(password, salt), want):
+            raise AuthenticationFailed('Authentication failed.')
+        self._fast[username] = tag
+
+    def has_user(self, username):
+        if super().has_user(username):
+            return True
+        if self._mm is not None:
+            self._load_record(username)
+            return super().has_user(username)
+        return False
+
+    def _add_record(self, line):
+        try:
+            name, salt, digest, home, perm = \
+                line.decode('utf8').rstrip('\n').split(':', 4)
+        except ValueError:
+            return
+        if super().has_user(name):
+            return
+        self._hashes[name] = (bytes.fromhex(salt), bytes.fromhex(digest))
+        super().add_user(name, '', home, perm)
+
+    def _load_record(self, username):
+        if self._indexed.is_set():
+            return
+        needle = username.encode('utf8') + b':'
+        pos = 0 if self._mm[:len(needle)] == needle \
+            else self._mm.find(b'\n' + needle)
+        if pos < 0:
+            return
+        if pos:
+            pos += 1
+        end = self._mm.find(b'\n', pos)
+        self._add_record(self._mm[pos:end if end >= 0 else None])
+
+    def _build_index(self):
+        pos = 0
+        while True:
+            end = self._mm.find(b'\n', pos)
+            line = self._mm[pos:end] if end >= 0 else self._mm[pos:]
+            if line:
+                self._add_record(line)
+            if end < 0:
+                break
+            pos = end + 1
+        self._indexed.set()
+
+def make_record(username, password, homedir, perm):
+    salt = os.urandom(16)
+    return '%s:%s:%s:%s:%s' % (username, salt.hex(),
+                               _digest(password, salt).hex(), homedir, perm)
@@ -0,0 +1,60 @@
+import os
+import sys
+import signal
+from pyftpdlib.servers import FTPServer
+from pyftpdlib.ioloop import IOLoop
+
+import workers
+
+# zero-downtime reload: SIGUSR2 execs a fresh copy of the server (picking
+# up code and main() config changes), which binds its own SO_REUSEPORT
+# socket on the same port, while the old process closes its listener and
+# keeps serving until every in-flight session — including the 100GB
+# uploads — drains to completion.  The kernel routes new connections to
+# the new listener the moment the old one closes, so nothing is dropped.
+# Every listener is SO_REUSEPORT-bound already (see workers.py), which is
+# what lets the replacement bind alongside instead of inheriting fds
+
+DRAIN_CHECK = 1.0
+
+def _respawn():
+    pid = os.fork()
+    if pid == 0:
+        os.execv(sys.executable, [sys.executable] + sys.argv)
+
+def _drain(server):
+    # stop accepting; existing sessions keep their channels registered,
+    # and we leave once the loop holds nothing but them wound down
+    server.close()
+    loop = IOLoop.instance()
+    def check():
+        if not loop.socket_map:
+            os._exit(0)
+        loop.call_later(DRAIN_CHECK, check)
+    loop.call_later(DRAIN_CHECK, check)
+
+def serve_forever(address, handler, workers_count=1,
+                  server_class=FTPServer):
+    master = os.getpid()
+
+    def child_setup(server):
+        def on_usr2(signum, frame):
+            if os.getpid() == master:
+                # single-process mode: spawn the replacement, then drain
+                _respawn()
+            _drain(server)
+        signal.signal(signal.SIGUSR2, on_usr2)
+
+    def master_usr2(signum, frame):
+        _respawn()
+        for pid in workers.worker_pids:
+            try:
+                os.kill(pid, signal.SIGUSR2)
+            except OSError:
+                pass
+
+    if workers_count > 1:
+        signal.signal(signal.SIGUSR2, master_usr2)
+    workers.serve_forever(address, handler, workers=workers_count,
+                          server_class=server_class,
+                          child_setup=child_setup)
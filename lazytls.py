@@ -0,0 +1,58 @@
+import signal
+import threading
+
+import tlscache
+import workers
+
+# fast restarts: the listening socket binds and accepts immediately while
+# the TLS context (and with a real certificate chain, most of the startup
+# cost) is built by a background thread kicked off at enable time.  An
+# AUTH that arrives before the context is ready gets a 431 and retries;
+# SIGHUP rebuilds the context off-loop and swaps it in atomically, so
+# certificates rotate without restarting serve_forever()
+
+class _ContextHolder:
+    def __init__(self, handler):
+        self._handler = handler
+        self._lock = threading.Lock()
+        self._building = False
+
+    def build(self):
+        with self._lock:
+            if self._building:
+                return
+            self._building = True
+        def run():
+            ctx = tlscache.make_context(self._handler.certfile,
+                                        self._handler.keyfile)
+            self._handler.ssl_context = ctx  # atomic swap; sessions pick it up
+            with self._lock:
+                self._building = False
+        threading.Thread(target=run, daemon=True).start()
+
+    def _start(self):
+        # fresh process: nothing forks mid-build any more, but clear the
+        # flag anyway so an inherited True can never wedge ftp_AUTH at 431
+        with self._lock:
+            self._building = False
+        self.build()
+
+class LazyTLSFTPHandlerMixin:
+    _ctx_holder = None
+
+    def ftp_AUTH(self, line):
+        if self.ssl_context is None:
+            self._ctx_holder.build()
+            self.respond('431 TLS not ready yet; try again.')
+            return
+        return super().ftp_AUTH(line)
+
+def enable(handler):
+    handler.ssl_context = None
+    holder = _ContextHolder(handler)
+    # the build thread would not survive the prefork in workers.py, so each
+    # serving process warms its own context right before its accept loop
+    workers.postfork(holder._start)
+    signal.signal(signal.SIGHUP, lambda signum, frame: holder.build())
+    return type('LazyTLSFTPHandler', (LazyTLSFTPHandlerMixin, handler),
+                {'_ctx_holder': holder})
@@ -0,0 +1,146 @@
+import os
+import time
+import threading
+from pyftpdlib.filesystems import AbstractedFS
+import workers
+
+# directory-listing cache: LIST/MLSD of huge directories stat millions of
+# entries and stall the event loop; we cache the fully formatted output per
+# directory, validate it against the directory mtime, refresh hot entries
+# from a background worker before they expire, and drop entries whenever a
+# write goes through the same fs
+
+TTL = 30.0
+REFRESH_EVERY = 5.0
+
+class _Entry:
+    __slots__ = ('lines', 'names', 'dir_mtime', 'built', 'hits')
+    def __init__(self, lines, names, dir_mtime):
+        self.lines = lines
+        self.names = names
+        self.dir_mtime = dir_mtime
+        self.built = time.monotonic()
+        self.hits = 0
+
+class ListingCache:
+    def __init__(self):
+        self._entries = {}
+        self._lock = threading.Lock()
+        self._refresher = None
+
+    def lookup(self, path):
+        with self._lock:
+            entry = self._entries.get(path)
+        if entry is None:
+            return None
+        try:
+            if os.stat(path).st_mtime != entry.dir_mtime:
+                self.invalidate(path)
+                return None
+        except OSError:
+            self.invalidate(path)
+            return None
+        if time.monotonic() - entry.built > TTL:
+            return None
+        entry.hits += 1
+        return entry
+
+    def store(self, path, lines, names):
+        try:
+            dir_mtime = os.stat(path).st_mtime
+        except OSError:
+            return
+        with self._lock:
+            self._entries[path] = _Entry(lines, names, dir_mtime)
+
+    def invalidate(self, path):
+        with self._lock:
+            self._entries.pop(path, None)
+
+    def invalidate_parent(self, path):
+        self.invalidate(os.path.dirname(path.rstrip(os.sep)) or os.sep)
+
+    def start_refresher(self, fs_factory):
+        if self._refresher is not None:
+            return
+        def loop():
+            while True:
+                time.sleep(REFRESH_EVERY)
+                now = time.monotonic()
+                with self._lock:
+                    stale = [p for p, e in self._entries.items()
+                             if e.hits > 0 and now - e.built > TTL - REFRESH_EVERY]
+                for path in stale:
+                    # nothing a bad entry raises may kill the thread: a
+                    # refresh that fails for any reason just falls back
+                    # to the on-demand rebuild
+                    try:
+                        _build(fs_factory(), path, self)
+                    except Exception:
+                        self.invalidate(path)
+        self._refresher = threading.Thread(target=loop, daemon=True)
+        self._refresher.start()
+
+cache = ListingCache()
+
+def _build(fs, path, into):
+    names = fs.listdir(path)
+    try:
+        names.sort()
+    except UnicodeDecodeError:
+        pass
+    lines = list(fs.format_list(path, names))
+    into.store(path, lines, names)
+    return lines, names
+
+class CachingFS(AbstractedFS):
+    def get_list_dir(self, path):
+        if not self.isdir(path):
+            return super().get_list_dir(path)
+        entry = cache.lookup(path)
+        if entry is not None:
+            return iter(entry.lines)
+        lines, _names = _build(self, path, cache)
+        return iter(lines)
+
+    def listdir(self, path):
+        entry = cache.lookup(path)
+        if entry is not None:
+            return list(entry.names)
+        return super().listdir(path)
+
+    def open(self, filename, mode):
+        if 'w' in mode or 'a' in mode or '+' in mode:
+            cache.invalidate_parent(filename)
+        return super().open(filename, mode)
+
+    def mkdir(self, path):
+        cache.invalidate_parent(path)
+        super().mkdir(path)
+
+    def rmdir(self, path):
+        cache.invalidate(path)
+        cache.invalidate_parent(path)
+        super().rmdir(path)
+
+    def remove(self, path):
+        cache.invalidate_parent(path)
+        super().remove(path)
+
+    def rename(self, src, dst):
+        cache.invalidate(src)
+        cache.invalidate_parent(src)
+        cache.invalidate_parent(dst)
+        super().rename(src, dst)
+
+class _RefresherChannel:
+    # minimal stand-in for the cmd_channel attributes format_list touches
+    use_gmt_times = True
+    unicode_errors = 'replace'
+
+def enable(handler):
+    handler.abstracted_fs = CachingFS
+    # the refresher owns a thread, which would not survive the prefork in
+    # workers.py; each serving process starts its own
+    workers.postfork(lambda: cache.start_refresher(
+        lambda: CachingFS(os.sep, _RefresherChannel())))
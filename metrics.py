@@ -0,0 +1,123 @@
+import os
+import json
+import time
+import socket
+import threading
+from pyftpdlib.ioloop import IOLoop
+import workers
+
+# always-on instrumentation: per-process counters bumped inline on the hot
+# path (plain int adds, GIL-atomic, no locks), an event-loop lag sampler,
+# and a local unix stats socket that serves a JSON snapshot per connection
+
+LAG_PERIOD = 1.0
+
+class Stats:
+    def __init__(self):
+        self.started = time.time()
+        self.active_sessions = 0
+        self.total_sessions = 0
+        self.handshakes = 0
+        self.bytes_in = 0
+        self.bytes_out = 0
+        self.event_loop_lag_s = 0.0
+        self.pool = None
+
+    def snapshot(self):
+        uptime = max(time.time() - self.started, 1e-9)
+        out = {
+            'uptime_s': uptime,
+            'active_sessions': self.active_sessions,
+            'total_sessions': self.total_sessions,
+            'handshakes': self.handshakes,
+            'handshakes_per_sec': self.handshakes / uptime,
+            'bytes_in': self.bytes_in,
+            'bytes_out': self.bytes_out,
+            'event_loop_lag_s': self.event_loop_lag_s,
+        }
+        if self.pool is not None:
+            leased, total = self.pool.occupancy()
+            out['passive_ports_leased'] = leased
+            out['passive_ports_total'] = total
+        return out
+
+stats = Stats()
+
+class MeteredDTPMixin:
+    def send(self, data):
+        sent = super().send(data)
+        stats.bytes_out += sent
+        return sent
+
+    def recv(self, buffer_size):
+        data = super().recv(buffer_size)
+        stats.bytes_in += len(data)
+        return data
+
+    def initiate_sendfile(self, *args, **kwargs):
+        # zero-copy RETR bypasses send(); count from the base byte counter
+        before = self.tot_bytes_sent
+        super().initiate_sendfile(*args, **kwargs)
+        stats.bytes_out += self.tot_bytes_sent - before
+
+def _sample_lag(ioloop):
+    state = {'expected': time.monotonic() + LAG_PERIOD}
+    def tick():
+        now = time.monotonic()
+        stats.event_loop_lag_s = max(0.0, now - state['expected'])
+        state['expected'] = now + LAG_PERIOD
+        ioloop.call_later(LAG_PERIOD, tick)
+    ioloop.call_later(LAG_PERIOD, tick)
+
+def _serve_stats(path):
+    try:
+        os.unlink(path)
+    except OSError:
+        pass
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    sock.bind(path)
+    sock.listen(4)
+    while True:
+        conn, _ = sock.accept()
+        try:
+            conn.sendall(json.dumps(stats.snapshot()).encode('utf8'))
+        except OSError:
+            pass
+        finally:
+            conn.close()
+
+def enable(handler, pool=None, sock_path=None):
+    stats.pool = pool
+    handler.dtp_handler = type('MeteredDTPHandler',
+                               (MeteredDTPMixin, handler.dtp_handler), {})
+    prev_connect = handler.on_connect
+    def on_connect(self):
+        stats.active_sessions += 1
+        stats.total_sessions += 1
+        prev_connect(self)
+    handler.on_connect = on_connect
+    prev_disconnect = handler.on_disconnect
+    def on_disconnect(self):
+        stats.active_sessions -= 1
+        prev_disconnect(self)
+    handler.on_disconnect = on_disconnect
+    if hasattr(handler, 'ftp_AUTH'):
+        prev_auth = handler.ftp_AUTH
+        def ftp_AUTH(self, line):
+            stats.handshakes += 1
+            return prev_auth(self, line)
+        handler.ftp_AUTH = ftp_AUTH
+    # the lag sampler and stats socket belong to the serving process, not
+    # the master: after the prefork in workers.py each worker arms its own
+    # sampler and binds its own socket (suffixed with the worker pid so
+    # siblings don't steal each other's path)
+    master_pid = os.getpid()
+    def start():
+        stats.started = time.time()
+        _sample_lag(IOLoop.instance())
+        path = sock_path or '/tmp/ftpstats-%d.sock' % os.getpid()
+        if os.getpid() != master_pid:
+            path = '%s.%d' % (path, os.getpid())
+        threading.Thread(target=_serve_stats, args=(path,),
+                         daemon=True).start()
+    workers.postfork(start)
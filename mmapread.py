@@ -0,0 +1,78 @@
+import os
+import mmap
+
+# mmap read path for large RETR: map the file once, tell the kernel the
+# access is sequential, and keep a WILLNEED window advised ahead of the
+# read cursor so cold NVMe files stream without re-faulting
+
+THRESHOLD = 64 * 1024 * 1024   # files below this keep the buffered path
+WINDOW = 8 * 1024 * 1024       # readahead advised past the cursor
+
+class MmapReader:
+    def __init__(self, fh, window=WINDOW):
+        self._fh = fh
+        self.name = getattr(fh, 'name', None)
+        self._mm = mmap.mmap(fh.fileno(), 0, prot=mmap.PROT_READ)
+        self._pos = 0
+        self._advised = 0
+        self._window = window
+        self.closed = False
+        if hasattr(self._mm, 'madvise'):
+            self._mm.madvise(mmap.MADV_SEQUENTIAL)
+            self._advise()
+
+    def _advise(self):
+        end = min(self._pos + self._window, len(self._mm))
+        if end > self._advised and hasattr(self._mm, 'madvise'):
+            start = self._pos - self._pos % mmap.PAGESIZE
+            self._mm.madvise(mmap.MADV_WILLNEED, start, end - start)
+            self._advised = end
+
+    def read(self, size=-1):
+        if size is None or size < 0:
+            size = len(self._mm) - self._pos
+        data = self._mm[self._pos:self._pos + size]
+        self._pos += len(data)
+        if self._advised - self._pos < self._window // 2:
+            self._advise()
+        return data
+
+    def seek(self, offset, whence=0):
+        if whence == 1:
+            offset += self._pos
+        elif whence == 2:
+            offset += len(self._mm)
+        self._pos = max(0, min(offset, len(self._mm)))
+        self._advised = self._pos
+        self._advise()
+
+    def tell(self):
+        return self._pos
+
+    def fileno(self):
+        # keeps the sendfile path working when it is preferred over reads
+        return self._fh.fileno()
+
+    def close(self):
+        if not self.closed:
+            self._mm.close()
+            self._fh.close()
+            self.closed = True
+
+class MmapFSMixin:
+    mmap_threshold = THRESHOLD
+
+    def open(self, filename, mode):
+        fh = super().open(filename, mode)
+        if 'r' in mode and '+' not in mode and 'w' not in mode:
+            try:
+                if os.fstat(fh.fileno()).st_size >= self.mmap_threshold:
+                    return MmapReader(fh)
+            except (OSError, ValueError):
+                pass
+        return fh
+
+def enable(handler, threshold=THRESHOLD):
+    handler.abstracted_fs = type('MmapFS',
+                                 (MmapFSMixin, handler.abstracted_fs),
+                                 {'mmap_threshold': threshold})
@@ -0,0 +1,117 @@
+import zlib
+import threading
+from collections import deque
+
+# MODE Z (deflate) for bandwidth-bound WAN links: data connections
+# compress/decompress in chunks interleaved with socket I/O, so the
+# compressor overlaps the send path instead of running as a pre-pass.
+# zlib contexts cannot be rewound after use, so the "pool" keeps a stock
+# of pre-built contexts topped up off the hot path; acquiring one during
+# transfer setup is a deque pop
+
+DEFAULT_LEVEL = 6
+POOL_TARGET = 32
+
+class ContextPool:
+    def __init__(self):
+        self._comp = {}  # level -> deque of compressobj
+        self._decomp = deque()
+        self._lock = threading.Lock()
+        self.user_levels = {}  # per-user compression level knob
+
+    def compressor(self, level=DEFAULT_LEVEL):
+        with self._lock:
+            free = self._comp.setdefault(level, deque())
+            ctx = free.popleft() if free else None
+        self._top_up(level)
+        return ctx if ctx is not None else zlib.compressobj(level)
+
+    def decompressor(self):
+        with self._lock:
+            ctx = self._decomp.popleft() if self._decomp else None
+        self._top_up(None)
+        return ctx if ctx is not None else zlib.decompressobj()
+
+    def _top_up(self, level):
+        def fill():
+            with self._lock:
+                if level is None:
+                    while len(self._decomp) < POOL_TARGET:
+                        self._decomp.append(zlib.decompressobj())
+                else:
+                    free = self._comp[level]
+                    while len(free) < POOL_TARGET:
+                        free.append(zlib.compressobj(level))
+        threading.Thread(target=fill, daemon=True).start()
+
+pool = ContextPool()
+
+class CompressingProducer:
+    def __init__(self, producer, compressor):
+        self._producer = producer
+        self._z = compressor
+        self._done = False
+
+    def more(self):
+        if self._done:
+            return b''
+        data = self._producer.more()
+        if not data:
+            self._done = True
+            return self._z.flush()
+        # sync-flush each chunk so output flows as the file is read
+        return self._z.compress(data) + self._z.flush(zlib.Z_SYNC_FLUSH)
+
+class ModeZDTPMixin:
+    def __init__(self, sock, cmd_channel):
+        super().__init__(sock, cmd_channel)
+        self._z_recv = None
+        self._z_on = getattr(cmd_channel, '_mode_z', False)
+        if self._z_on:
+            level = pool.user_levels.get(
+                getattr(cmd_channel, 'username', None), DEFAULT_LEVEL)
+            self._z_level = level
+
+    def push_with_producer(self, producer):
+        if self._z_on:
+            producer = CompressingProducer(producer,
+                                           pool.compressor(self._z_level))
+        super().push_with_producer(producer)
+
+    def recv(self, buffer_size):
+        data = super().recv(buffer_size)
+        if self._z_on and getattr(self, 'receive', False):
+            if self._z_recv is None:
+                self._z_recv = pool.decompressor()
+            if data:
+                return self._z_recv.decompress(data)
+        return data
+
+    def handle_close(self):
+        # EOF: the base close sequence closes file_obj and fires the
+        # completion hooks (staging rename, digests, accounting), so the
+        # stream tail has to land in the file before any of that runs
+        if self._z_recv is not None:
+            tail = self._z_recv.flush()
+            self._z_recv = None
+            if tail and self.file_obj is not None \
+                    and not self.file_obj.closed:
+                self.file_obj.write(tail)
+        super().handle_close()
+
+class ModeZFTPHandlerMixin:
+    _mode_z = False
+
+    def ftp_MODE(self, line):
+        if line.upper() == 'Z':
+            self._mode_z = True
+            self.respond('200 Transfer mode set to: Z.')
+            return
+        if line.upper() == 'S':
+            self._mode_z = False
+        super().ftp_MODE(line)
+
+def enable(handler):
+    handler.dtp_handler = type('ModeZDTPHandler',
+                               (ModeZDTPMixin, handler.dtp_handler), {})
+    return type('ModeZFTPHandler', (ModeZFTPHandlerMixin, handler), {})
@@ -0,0 +1,52 @@
+# small-file pipelining: backup jobs pushing millions of 4-64KB files pay
+# a PASV + bind + accept + teardown cycle per file, and setup dominates
+# wall time.  In pipelined mode the passive listener survives the transfer
+# it accepted, and a repeat PASV in the same session answers instantly
+# with the already-bound port instead of allocating and binding a new
+# one — so consecutive transfers reuse one listener and the per-file cost
+# collapses to a plain connect
+
+class PersistentPassiveDTPMixin:
+    def handle_accepted(self, sock, addr):
+        # the persistent listener stays bound between transfers, so a
+        # second connection can land while one is still running (trivial
+        # from behind the same NAT the first came from); handing it to
+        # _on_dtp_connection would replace the active data channel
+        # mid-transfer, so refuse it outright
+        active = getattr(self.cmd_channel, 'data_channel', None)
+        if active is not None and not getattr(active, '_closed', False):
+            sock.close()
+            return
+        # the stock PassiveDTP closes the listener right after handing the
+        # connection to the command channel; keep it listening for the
+        # session's next transfer
+        real_close, self.close = self.close, lambda: None
+        try:
+            super().handle_accepted(sock, addr)
+        finally:
+            self.close = real_close
+        # _on_dtp_connection dropped its reference (and no-op "closed" us)
+        # during the handoff; re-attach so the next PASV finds the listener
+        # and _shutdown_connecting_dtp closes it for real at session end
+        if self.socket is not None and self.cmd_channel is not None \
+                and not self.cmd_channel._closed:
+            self.cmd_channel._dtp_acceptor = self
+
+class PipelinedFTPHandlerMixin:
+    def ftp_PASV(self, line):
+        acceptor = self._dtp_acceptor
+        if acceptor is not None and acceptor.socket is not None:
+            ip = self.masquerade_address or \
+                self.socket.getsockname()[0]
+            port = acceptor.socket.getsockname()[1]
+            self.respond('227 Entering passive mode (%s,%d,%d).' % (
+                ip.replace('.', ','), port >> 8 & 0xff, port & 0xff))
+            return
+        super().ftp_PASV(line)
+
+def enable(handler):
+    handler.passive_dtp = type('PersistentPassiveDTP',
+                               (PersistentPassiveDTPMixin,
+                                handler.passive_dtp), {})
+    return type('PipelinedFTPHandler',
+                (PipelinedFTPHandlerMixin, handler), {})
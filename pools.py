@@ -0,0 +1,49 @@
+import gc
+import threading
+from collections import deque
+
+# allocation-churn control for connect storms: long-lived startup objects
+# are frozen out of the collector and the gen-0 threshold is raised so
+# per-connection garbage stops triggering collections that pause every
+# session, and hot-path consumers draw their big data buffers from a
+# freelist instead of allocating fresh arenas per transfer
+
+GEN0_THRESHOLD = 50000
+
+class BufferPool:
+    def __init__(self, size, limit=64):
+        self.size = size
+        self._limit = limit
+        self._free = deque()
+        self._lock = threading.Lock()
+
+    def acquire(self):
+        with self._lock:
+            if self._free:
+                return self._free.popleft()
+        return bytearray(self.size)
+
+    def release(self, buf):
+        if len(buf) != self.size:
+            return
+        with self._lock:
+            if len(self._free) < self._limit:
+                self._free.append(buf)
+
+_pools = {}
+_pools_lock = threading.Lock()
+
+def pool(size):
+    with _pools_lock:
+        if size not in _pools:
+            _pools[size] = BufferPool(size)
+        return _pools[size]
+
+def enable():
+    # call after server setup: everything alive now is permanent state,
+    # so take it out of every future collection and make gen-0 trigger
+    # rarely enough that connect bursts stop lining up with GC pauses
+    gc.collect()
+    gc.set_threshold(GEN0_THRESHOLD, 50, 50)
+    if hasattr(gc, 'freeze'):
+        gc.freeze()
@@ -0,0 +1,123 @@
+import weakref
+import threading
+from collections import deque
+from pyftpdlib.handlers import PassiveDTP
+import workers
+
+# O(1) passive-port allocator: the stock handler copies the whole
+# passive_ports range and probes random ports on every PASV, which at 2k
+# concurrent transfers turns into a linear hunt.  PortPool keeps a free
+# list, leases ports as they are handed out, and gets them back the moment
+# the passive listener closes; freed ports are reused LIFO so a session
+# doing back-to-back transfers tends to land on the same port.  Leases
+# are tied to their listener, never to the clock: a pipelined listener
+# legitimately holds its port for a whole session, so the only safe time
+# to take one back is when the object that bound it is provably gone
+
+class PortPool:
+    def __init__(self, ports):
+        self._all = list(ports)
+        self._free = deque(self._all)
+        self._leased = {}  # port -> weakref to the listener (None until bound)
+        self._pending = []  # candidates handed to the current PASV
+        self._lock = threading.Lock()
+        workers.postfork(self._partition)
+
+    def _partition(self):
+        # prefork workers inherit identical copies of the free list, so
+        # without this siblings lease the same ports, collide at bind and
+        # fall through to a kernel-assigned port outside the range the
+        # firewall was provisioned for.  Stripe the range so each worker
+        # owns a disjoint slice
+        if workers.worker_count <= 1:
+            return
+        with self._lock:
+            self._free = deque(
+                port for i, port in enumerate(self._all)
+                if i % workers.worker_count == workers.worker_index)
+            self._leased.clear()
+            self._pending = []
+
+    def acquire(self):
+        with self._lock:
+            if not self._free:
+                self._reclaim_dead()
+            if not self._free:
+                return None
+            port = self._free.popleft()
+            self._leased[port] = None
+            return port
+
+    def release(self, port):
+        with self._lock:
+            if port in self._leased:
+                del self._leased[port]
+                self._free.appendleft(port)
+
+    def occupancy(self):
+        with self._lock:
+            return len(self._leased), len(self._leased) + len(self._free)
+
+    def _reclaim_dead(self):
+        # called with the lock held.  Ports normally come back through the
+        # listener's close(); when one died without closing its weakref is
+        # dead (or its socket gone) and the port is safe to reuse.  Leases
+        # still awaiting confirm() belong to a PASV in flight — leave them
+        for port, ref in list(self._leased.items()):
+            if ref is None:
+                continue
+            holder = ref()
+            if holder is None or holder.socket is None:
+                del self._leased[port]
+                self._free.append(port)
+
+    def confirm(self, bound_port, holder=None):
+        # PASV handling is serialized on the event loop: release every
+        # candidate from the last batch except the one that actually
+        # bound, and remember who holds it
+        with self._lock:
+            pending, self._pending = self._pending, []
+            if holder is not None and bound_port in self._leased:
+                self._leased[bound_port] = weakref.ref(holder)
+        for port in pending:
+            if port != bound_port:
+                self.release(port)
+
+    # the handler does list(passive_ports); yield a few free candidates so
+    # the first bind attempt almost always succeeds
+    def __iter__(self):
+        self._pending = []
+        for _ in range(8):
+            port = self.acquire()
+            if port is None:
+                return
+            self._pending.append(port)
+            yield port
+
+class PooledPassiveDTP(PassiveDTP):
+    pool = None
+
+    def __init__(self, cmd_channel, extmode=False):
+        self._pool_port = None
+        try:
+            super().__init__(cmd_channel, extmode)
+        finally:
+            # confirm unconditionally so a failed bind still returns the
+            # whole candidate batch to the pool
+            if getattr(self, 'socket', None) is not None:
+                self._pool_port = self.socket.getsockname()[1]
+            if self.pool is not None:
+                self.pool.confirm(self._pool_port, self)
+
+    def close(self):
+        if self.pool is not None and self._pool_port is not None:
+            self.pool.release(self._pool_port)
+            self._pool_port = None
+        super().close()
+
+def enable(handler, ports):
+    pool = PortPool(ports)
+    handler.passive_ports = pool
+    handler.passive_dtp = type('PooledPassiveDTP', (PooledPassiveDTP,),
+                               {'pool': pool})
+    return pool
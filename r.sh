@@ -9,3 +9,6 @@ openssl genrsa -out server.key 2048
 openssl req -new -x509 -days 3650 -key server.key -out server.crt
 nohup python3 sslftp.py >/dev/null 2>&1&
 nohup python3 windows.py >/dev/null 2>&1&
+# deploys: send SIGUSR2 instead of killing; the old process drains
+# in-flight transfers while a fresh one takes new connections
+# pkill -USR2 -f sslftp.py ; pkill -USR2 -f windows.py
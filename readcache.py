@@ -0,0 +1,127 @@
+import io
+import os
+import hashlib
+import threading
+from collections import OrderedDict
+
+# tiered read cache for the hot 5% of files that carry 80% of RETR
+# traffic.  The RAM tier is a segmented LRU (new entries sit in a
+# probation segment and only a second hit promotes them), so a one-shot
+# bulk mirror pass churns probation and never evicts the protected hot
+# set.  Entries evicted from RAM can spill to an NVMe directory; hits are
+# validated against mtime+size and served from an in-memory buffer
+
+RAM_MAX = 512 * 1024 * 1024
+FILE_MAX = 16 * 1024 * 1024   # bigger files stream from disk (or mmap)
+
+class SegmentedLRU:
+    def __init__(self, ram_max=RAM_MAX, spill_dir=None):
+        self.ram_max = ram_max
+        self.spill_dir = spill_dir
+        self._probation = OrderedDict()  # key -> (mtime, size, data)
+        self._protected = OrderedDict()
+        self._ram_used = 0
+        self._lock = threading.Lock()
+        if spill_dir:
+            os.makedirs(spill_dir, exist_ok=True)
+
+    def _spill_path(self, key):
+        return os.path.join(self.spill_dir,
+                            hashlib.sha1(key.encode('utf8')).hexdigest())
+
+    def get(self, key, mtime, size):
+        with self._lock:
+            for segment, promote in ((self._protected, False),
+                                     (self._probation, True)):
+                entry = segment.get(key)
+                if entry is None:
+                    continue
+                if entry[0] != mtime or entry[1] != size:
+                    del segment[key]
+                    self._ram_used -= entry[1]
+                    return None
+                if promote:
+                    del self._probation[key]
+                    self._protected[key] = entry
+                else:
+                    self._protected.move_to_end(key)
+                return entry[2]
+        return self._unspill(key, mtime, size)
+
+    def _unspill(self, key, mtime, size):
+        if not self.spill_dir:
+            return None
+        path = self._spill_path(key)
+        try:
+            if os.stat(path).st_mtime != mtime:
+                return None
+            with open(path, 'rb') as f:
+                data = f.read()
+        except OSError:
+            return None
+        if len(data) != size:
+            return None
+        self.put(key, mtime, size, data)
+        return data
+
+    def put(self, key, mtime, size, data):
+        if size > FILE_MAX:
+            return
+        with self._lock:
+            # concurrent misses and _unspill re-adds insert over an
+            # existing entry; drop it first so _ram_used doesn't drift
+            for segment in (self._probation, self._protected):
+                old = segment.pop(key, None)
+                if old is not None:
+                    self._ram_used -= old[1]
+            self._probation[key] = (mtime, size, data)
+            self._ram_used += size
+            while self._ram_used > self.ram_max:
+                victim_seg = self._probation or self._protected
+                vkey, ventry = victim_seg.popitem(last=False)
+                self._ram_used -= ventry[1]
+                if self.spill_dir and victim_seg is self._protected:
+                    self._spill(vkey, ventry)
+
+    def _spill(self, key, entry):
+        path = self._spill_path(key)
+        try:
+            with open(path + '.tmp', 'wb') as f:
+                f.write(entry[2])
+            os.utime(path + '.tmp', (entry[0], entry[0]))
+            os.replace(path + '.tmp', path)
+        except OSError:
+            pass
+
+cache = SegmentedLRU()
+
+class _CachedReader(io.BytesIO):
+    def __init__(self, data, name):
+        super().__init__(data)
+        self.name = name
+
+class ReadCacheFSMixin:
+    def open(self, filename, mode):
+        if 'r' not in mode or '+' in mode:
+            return super().open(filename, mode)
+        try:
+            st = os.stat(filename)
+        except OSError:
+            return super().open(filename, mode)
+        if not 0 < st.st_size <= FILE_MAX:
+            return super().open(filename, mode)
+        data = cache.get(filename, st.st_mtime, st.st_size)
+        if data is None:
+            fh = super().open(filename, mode)
+            data = fh.read()
+            fh.close()
+            cache.put(filename, st.st_mtime, st.st_size, data)
+        return _CachedReader(data, filename)
+
+def enable(handler, ram_max=RAM_MAX, spill_dir=None):
+    global cache
+    cache = SegmentedLRU(ram_max, spill_dir)
+    handler.abstracted_fs = type('ReadCacheFS',
+                                 (ReadCacheFSMixin,
+                                  handler.abstracted_fs), {})
+    return cache
@@ -0,0 +1,147 @@
+import os
+import json
+import zlib
+from pyftpdlib.filesystems import AbstractedFS
+
+# streaming resume index: while a STOR/APPE is in flight we keep rolling
+# crc32s of every received chunk in a sidecar next to the file.  When a
+# client comes back with REST after a dropped 100GB upload we validate the
+# offset by re-reading at most one chunk tail instead of re-hashing the
+# whole file, and anything past the validated length is refused so the
+# transfer restarts from known-good data
+
+CHUNK = 4 * 1024 * 1024
+SAVE_EVERY = 16  # chunks between index writes
+
+def _sidecar(path):
+    head, tail = os.path.split(path)
+    return os.path.join(head, '.%s.ftpresume' % tail)
+
+class _Index:
+    def __init__(self, path):
+        self.path = path
+        self.crcs = []
+        self.tail = 0  # bytes past the last whole chunk
+
+    @property
+    def length(self):
+        return len(self.crcs) * CHUNK + self.tail
+
+    def save(self):
+        tmp = _sidecar(self.path) + '.tmp'
+        with open(tmp, 'w') as f:
+            json.dump({'chunk': CHUNK, 'crcs': self.crcs,
+                       'tail': self.tail}, f)
+        os.replace(tmp, _sidecar(self.path))
+
+    @classmethod
+    def load(cls, path):
+        try:
+            with open(_sidecar(path)) as f:
+                raw = json.load(f)
+        except (OSError, ValueError):
+            return None
+        if raw.get('chunk') != CHUNK:
+            return None
+        idx = cls(path)
+        idx.crcs = raw.get('crcs', [])
+        idx.tail = int(raw.get('tail', 0))
+        return idx
+
+def discard(path):
+    try:
+        os.unlink(_sidecar(path))
+    except OSError:
+        pass
+
+class TrackedWriter:
+    def __init__(self, fh, path):
+        self._fh = fh
+        self.name = getattr(fh, 'name', path)
+        self._path = path
+        self._index = _Index(path)
+        self._crc = 0
+        self._filled = 0  # bytes in the current chunk
+        self._dirty = 0
+        self.closed = False
+
+    def seek(self, offset, whence=0):
+        if whence != 0:
+            self._fh.seek(offset, whence)
+            return
+        index = _Index.load(self._path)
+        if offset and (index is None or offset > index.length):
+            raise OSError('resume offset %d beyond validated data' % offset)
+        whole = offset // CHUNK
+        part = offset % CHUNK
+        if index is not None and whole <= len(index.crcs):
+            if whole >= 1:
+                # verify the last full chunk on disk against its stored crc
+                self._fh.seek((whole - 1) * CHUNK)
+                if zlib.crc32(self._fh.read(CHUNK)) != index.crcs[whole - 1]:
+                    raise OSError('resume checksum mismatch at chunk %d'
+                                  % (whole - 1))
+            # re-read only the partial chunk the resume lands in
+            self._fh.seek(whole * CHUNK)
+            data = self._fh.read(part)
+            if part and (len(data) != part or index.tail < part and
+                         whole == len(index.crcs)):
+                raise OSError('resume offset %d beyond validated data'
+                              % offset)
+            self._index.crcs = index.crcs[:whole]
+            self._crc = zlib.crc32(data)
+            self._filled = part
+        self._fh.seek(offset)
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            take = min(CHUNK - self._filled, len(view))
+            self._crc = zlib.crc32(view[:take], self._crc)
+            self._filled += take
+            view = view[take:]
+            if self._filled == CHUNK:
+                self._index.crcs.append(self._crc)
+                self._crc = 0
+                self._filled = 0
+                self._dirty += 1
+                if self._dirty >= SAVE_EVERY:
+                    self._sync()
+        return self._fh.write(data)
+
+    def _sync(self):
+        self._index.tail = self._filled
+        self._index.save()
+        self._dirty = 0
+
+    def close(self):
+        if not self.closed:
+            self._sync()
+            self._fh.close()
+            self.closed = True
+
+    def __getattr__(self, name):
+        return getattr(self._fh, name)
+
+class ResumeFSMixin:
+    def open(self, filename, mode):
+        fh = super().open(filename, mode)
+        if 'a' in mode:
+            # APPE: the bytes already in the file were never chunk-hashed,
+            # so a fresh index here would record this session's chunks at
+            # offset 0 and poison the next REST with a spurious checksum
+            # failure.  Appends go untracked; a sidecar left by an earlier
+            # STOR stays valid for the prefix it actually covers
+            return fh
+        if 'w' in mode or '+' in mode:
+            return TrackedWriter(fh, filename)
+        return fh
+
+def enable(handler):
+    handler.abstracted_fs = type('ResumeFS',
+                                 (ResumeFSMixin, handler.abstracted_fs), {})
+    previous = handler.on_file_received
+    def on_file_received(self, file):
+        discard(file)  # complete: no index to keep
+        previous(self, file)
+    handler.on_file_received = on_file_received
@@ -0,0 +1,124 @@
+import time
+import threading
+
+# in-process bandwidth shaping: hierarchical token buckets (per-user under
+# a per-server global) charged on every data-channel send/recv.  Refill is
+# computed from the monotonic clock at charge time, so shaping costs one
+# clock read per chunk and no timers while under the limit.  Chunks are
+# transferred full-size and charged afterwards — the same scheme as
+# pyftpdlib's ThrottledDTPHandler — and when a bucket is overdrawn the
+# channel is deregistered from the event loop and re-added via call_later
+# once the debt is paid, so a throttled transfer costs zero syscalls while
+# it waits instead of spinning on a writable socket
+
+class TokenBucket:
+    def __init__(self, rate, burst=None):
+        self.rate = float(rate)  # bytes/sec
+        self.burst = float(burst if burst is not None else rate)
+        self._tokens = self.burst
+        self._last = time.monotonic()
+        self._lock = threading.Lock()
+
+    def grant(self, want):
+        with self._lock:
+            self._refill()
+            allowed = int(min(want, max(self._tokens, 0)))
+            self._tokens -= allowed
+            return allowed
+
+    def charge(self, n):
+        # debit n (may overdraw); returns seconds until the balance is
+        # non-negative again, 0.0 when still within the limit
+        with self._lock:
+            self._refill()
+            self._tokens -= n
+            if self._tokens >= 0:
+                return 0.0
+            return -self._tokens / self.rate
+
+    def _refill(self):
+        now = time.monotonic()
+        self._tokens = min(self.burst,
+                           self._tokens + (now - self._last) * self.rate)
+        self._last = now
+
+class Bank:
+    def __init__(self, global_send=None, global_recv=None):
+        self._global = {
+            'send': TokenBucket(global_send) if global_send else None,
+            'recv': TokenBucket(global_recv) if global_recv else None,
+        }
+        self._users = {}  # username -> {'send': bucket, 'recv': bucket}
+
+    def set_user_limit(self, username, send=None, recv=None):
+        self._users[username] = {
+            'send': TokenBucket(send) if send else None,
+            'recv': TokenBucket(recv) if recv else None,
+        }
+
+    def buckets(self, username, direction):
+        out = []
+        user = self._users.get(username)
+        if user and user[direction]:
+            out.append(user[direction])
+        if self._global[direction]:
+            out.append(self._global[direction])
+        return out
+
+class ShapingDTPMixin:
+    bank = None
+
+    def __init__(self, sock, cmd_channel):
+        super().__init__(sock, cmd_channel)
+        self._shaper_timer = None
+
+    def _charge(self, direction, nbytes):
+        if not nbytes or self._shaper_timer is not None:
+            return
+        username = getattr(self.cmd_channel, 'username', None)
+        delay = 0.0
+        for bucket in self.bank.buckets(username, direction):
+            delay = max(delay, bucket.charge(nbytes))
+        if delay > 0:
+            self._suspend(delay)
+
+    def _suspend(self, seconds):
+        event = self.ioloop.READ if getattr(self, 'receive', False) \
+            else self.ioloop.WRITE
+        def resume():
+            self._shaper_timer = None
+            if not self._closed:
+                self.add_channel(events=event)
+        self.del_channel()
+        self._shaper_timer = self.ioloop.call_later(
+            seconds, resume, _errback=self.handle_error)
+
+    def send(self, data):
+        sent = super().send(data)
+        self._charge('send', sent)
+        return sent
+
+    def recv(self, buffer_size):
+        data = super().recv(buffer_size)
+        self._charge('recv', len(data))
+        return data
+
+    def initiate_sendfile(self, *args, **kwargs):
+        # zero-copy RETR bypasses send(); charge from the byte counter
+        # the base class maintains across the sendfile() calls
+        before = self.tot_bytes_sent
+        super().initiate_sendfile(*args, **kwargs)
+        self._charge('send', self.tot_bytes_sent - before)
+
+    def close(self):
+        if self._shaper_timer is not None and not self._shaper_timer.cancelled:
+            self._shaper_timer.cancel()
+            self._shaper_timer = None
+        super().close()
+
+def enable(handler, global_send=None, global_recv=None):
+    bank = Bank(global_send, global_recv)
+    handler.dtp_handler = type('ShapingDTPHandler',
+                               (ShapingDTPMixin, handler.dtp_handler),
+                               {'bank': bank})
+    return bank
@@ -0,0 +1,193 @@
+import os
+import mmap
+import fcntl
+import struct
+import hashlib
+import threading
+
+# cross-instance coordination: both servers attach the same small
+# shared-memory segment (a file in /dev/shm) holding global transfer and
+# byte counters plus a fixed per-user slot table of session counts and
+# transferred bytes.  Limits checked against the board apply across the
+# pair, so connecting to port 21 and 2121 at once no longer doubles a
+# user's quota.  Updates take a short flock and the data path batches its
+# byte counts, so the segment is touched a few times per MB, not per chunk
+
+BOARD_PATH = '/dev/shm/ftp-coord'
+SLOTS = 256
+NAME_LEN = 32
+SLOT_FMT = '<%dsQQQ' % NAME_LEN   # name, sessions, bytes_in, bytes_out
+SLOT_SIZE = struct.calcsize(SLOT_FMT)
+HEADER_FMT = '<QQQ'               # transfers, bytes_in, bytes_out
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+BATCH = 1024 * 1024               # bytes accumulated before a flush
+
+class Board:
+    def __init__(self, path=BOARD_PATH):
+        size = HEADER_SIZE + SLOTS * SLOT_SIZE
+        self._fd = os.open(path, os.O_RDWR | os.O_CREAT, 0o600)
+        os.ftruncate(self._fd, size)
+        self._mm = mmap.mmap(self._fd, size)
+        self._lock = threading.Lock()
+        # session counts only decrement through on_disconnect, so a crash
+        # or kill -9 leaks them in /dev/shm forever and eventually locks
+        # users out.  Every live instance (and, via fork, its workers)
+        # holds a shared flock on a presence file; if we can grab it
+        # exclusively on attach, nobody else is alive and whatever counts
+        # survived belong to dead processes — zero them.  flock drops with
+        # the process, so this needs no cooperation from the crashed side
+        self._presence = os.open(path + '.live', os.O_RDWR | os.O_CREAT,
+                                 0o600)
+        try:
+            fcntl.flock(self._presence, fcntl.LOCK_EX | fcntl.LOCK_NB)
+        except OSError:
+            pass  # another live instance vouches for the counts
+        else:
+            self._reset_sessions()
+        fcntl.flock(self._presence, fcntl.LOCK_SH)
+
+    def _locked(method):
+        def wrapper(self, *args, **kwargs):
+            with self._lock:
+                fcntl.flock(self._fd, fcntl.LOCK_EX)
+                try:
+                    return method(self, *args, **kwargs)
+                finally:
+                    fcntl.flock(self._fd, fcntl.LOCK_UN)
+        return wrapper
+
+    def _slot(self, username):
+        raw = username.encode('utf8')[:NAME_LEN]
+        digest = hashlib.sha1(raw).digest()
+        base = int.from_bytes(digest[:4], 'little') % SLOTS
+        for probe in range(SLOTS):
+            off = HEADER_SIZE + ((base + probe) % SLOTS) * SLOT_SIZE
+            name = struct.unpack_from('<%ds' % NAME_LEN, self._mm, off)[0]
+            name = name.rstrip(b'\0')
+            if name == raw:
+                return off
+            if not name:
+                struct.pack_into('<%ds' % NAME_LEN, self._mm, off, raw)
+                return off
+        return None
+
+    @_locked
+    def _reset_sessions(self):
+        for i in range(SLOTS):
+            off = HEADER_SIZE + i * SLOT_SIZE
+            name, sessions, bi, bo = struct.unpack_from(SLOT_FMT,
+                                                        self._mm, off)
+            if name.rstrip(b'\0') and sessions:
+                struct.pack_into(SLOT_FMT, self._mm, off, name, 0, bi, bo)
+
+    @_locked
+    def session_started(self, username, limit=None):
+        # returns False when the cross-instance session limit is hit
+        off = self._slot(username)
+        if off is None:
+            return True
+        name, sessions, bi, bo = struct.unpack_from(SLOT_FMT, self._mm, off)
+        if limit is not None and sessions >= limit:
+            return False
+        struct.pack_into(SLOT_FMT, self._mm, off, name, sessions + 1, bi, bo)
+        return True
+
+    @_locked
+    def session_ended(self, username):
+        off = self._slot(username)
+        if off is None:
+            return
+        name, sessions, bi, bo = struct.unpack_from(SLOT_FMT, self._mm, off)
+        struct.pack_into(SLOT_FMT, self._mm, off, name,
+                         max(0, sessions - 1), bi, bo)
+
+    @_locked
+    def add_bytes(self, username, bytes_in, bytes_out, transfers=0):
+        t, gi, go = struct.unpack_from(HEADER_FMT, self._mm, 0)
+        struct.pack_into(HEADER_FMT, self._mm, 0, t + transfers,
+                         gi + bytes_in, go + bytes_out)
+        off = self._slot(username) if username else None
+        if off is not None:
+            name, sessions, bi, bo = struct.unpack_from(SLOT_FMT,
+                                                        self._mm, off)
+            struct.pack_into(SLOT_FMT, self._mm, off, name, sessions,
+                             bi + bytes_in, bo + bytes_out)
+
+    @_locked
+    def snapshot(self):
+        transfers, bi, bo = struct.unpack_from(HEADER_FMT, self._mm, 0)
+        users = {}
+        for i in range(SLOTS):
+            off = HEADER_SIZE + i * SLOT_SIZE
+            name, sessions, ubi, ubo = struct.unpack_from(SLOT_FMT,
+                                                          self._mm, off)
+            name = name.rstrip(b'\0')
+            if name:
+                users[name.decode('utf8', 'replace')] = {
+                    'sessions': sessions, 'bytes_in': ubi, 'bytes_out': ubo}
+        return {'transfers': transfers, 'bytes_in': bi, 'bytes_out': bo,
+                'users': users}
+
+class SharedDTPMixin:
+    board = None
+
+    def __init__(self, sock, cmd_channel):
+        super().__init__(sock, cmd_channel)
+        self._board_in = 0
+        self._board_out = 0
+
+    def send(self, data):
+        sent = super().send(data)
+        self._board_out += sent
+        if self._board_out >= BATCH:
+            self._board_flush()
+        return sent
+
+    def recv(self, buffer_size):
+        data = super().recv(buffer_size)
+        self._board_in += len(data)
+        if self._board_in >= BATCH:
+            self._board_flush()
+        return data
+
+    def initiate_sendfile(self, *args, **kwargs):
+        # zero-copy RETR bypasses send(); batch from the base byte counter
+        before = self.tot_bytes_sent
+        super().initiate_sendfile(*args, **kwargs)
+        self._board_out += self.tot_bytes_sent - before
+        if self._board_out >= BATCH:
+            self._board_flush()
+
+    def _board_flush(self, transfers=0):
+        self.board.add_bytes(getattr(self.cmd_channel, 'username', None),
+                             self._board_in, self._board_out, transfers)
+        self._board_in = self._board_out = 0
+
+    def close(self):
+        if self._board_in or self._board_out:
+            self._board_flush(transfers=1)
+        super().close()
+
+def enable(handler, session_limit=None, path=BOARD_PATH):
+    board = Board(path)
+    handler.dtp_handler = type('SharedDTPHandler',
+                               (SharedDTPMixin, handler.dtp_handler),
+                               {'board': board})
+    previous_login = handler.on_login
+    def on_login(self, username):
+        if not board.session_started(username, session_limit):
+            self.respond('421 Too many sessions for %s; closing.' % username)
+            self.close_when_done()
+            return
+        self._board_session = username
+        previous_login(self, username)
+    handler.on_login = on_login
+    previous_disconnect = handler.on_disconnect
+    def on_disconnect(self):
+        username = getattr(self, '_board_session', None)
+        if username:
+            board.session_ended(username)
+            self._board_session = None
+        previous_disconnect(self)
+    handler.on_disconnect = on_disconnect
+    return board
@@ -1,9 +1,32 @@
 #!/usr/bin/python3
+import os
 from pyftpdlib.servers import FTPServer
-from pyftpdlib.authorizers import DummyAuthorizer
 from pyftpdlib.handlers import TLS_FTPHandler
+import hotreload
+import pools
+import hashauth
+import lazytls
+import listcache
+import portpool
+import shaper
+import resume
+import metrics
+import shared
+import binlog
+import mmapread
+import striping
+import streamlist
+import readcache
+import staging
+import prefetch
+import modez
+import admission
+import eventloop
 def main():
-    authorizer = DummyAuthorizer()
+    #FTP_EVENT_ENGINE=epoll|kqueue|poll|select overrides the poller
+    eventloop.enable(os.environ.get('FTP_EVENT_ENGINE'))
+    #hashed file-backed store; FTP_USERS_DB points at the big user db
+    authorizer = hashauth.HashedAuthorizer(os.environ.get('FTP_USERS_DB'))
     authorizer.add_user('wangyifan', 'helloUSA', '..', perm='elradfmwMT')
     #authorizer.add_anonymous('.')
     handler = TLS_FTPHandler
@@ -14,8 +37,44 @@ def main():
     handler.tls_control_required = True
     handler.tls_data_required = True
     handler.masquerade_address = '185.161.70.200'
-    handler.passive_ports = range(1000,2500)
-    server = FTPServer(('0.0.0.0', 2121), handler)
-    server.serve_forever()
+    #O(1) free-list allocator over the old range(1000,2500)
+    pool = portpool.enable(handler, range(1000,2500))
+    #cache formatted listings of the big ingest dirs; writes invalidate
+    listcache.enable(handler)
+    #token buckets: bulk mirror user capped so interactive sessions keep headroom
+    bank = shaper.enable(handler)
+    bank.set_user_limit('wangyifan', send=80*1024*1024, recv=80*1024*1024)
+    #chunk-checksummed sidecar index so REST resumes skip full re-reads
+    resume.enable(handler)
+    #mmap + madvise readahead for RETR of files over 64MB
+    mmapread.enable(handler)
+    #scandir-backed batched listing generator, constant memory per LIST
+    streamlist.enable(handler)
+    #scan-resistant RAM cache for the hot RETR set; FTP_CACHE_SPILL adds an NVMe tier
+    readcache.enable(handler, spill_dir=os.environ.get('FTP_CACHE_SPILL'))
+    #STOR lands in a hidden per-user staging dir, committed by rename
+    staging.enable(handler)
+    #counters + loop-lag sampler; snapshot via the unix stats socket
+    metrics.enable(handler, pool=pool, sock_path='/tmp/ftpstats-2121.sock')
+    #both instances share one /dev/shm board: global session cap per user
+    board = shared.enable(handler, session_limit=8)
+    #per-transfer records into an mmap'd ring; dump with binlog.py
+    binlog.enable(handler, '/var/tmp/ftp-sslftp.ring')
+    #RANG command: clients stripe one file across parallel data connections
+    handler = striping.enable(handler)
+    #MODE Z deflate with pre-built compressor contexts
+    handler = modez.enable(handler)
+    #bind immediately; TLS context builds in the background, SIGHUP reloads certs
+    handler = lazytls.enable(handler)
+    #warm stats after CWD and newest-file blocks after LIST
+    handler = prefetch.enable(handler)
+    #shed excess connections at accept time, before any TLS work
+    admission_ctl, server_class = admission.enable(handler)
+    #freeze startup state out of the GC and raise gen-0 threshold
+    pools.enable()
+    #FTP_WORKERS=N preforks N accept loops; SIGUSR2 reloads with zero downtime
+    hotreload.serve_forever(('0.0.0.0', 2121), handler,
+                            workers_count=int(os.environ.get('FTP_WORKERS', '1')),
+                            server_class=server_class)
 if __name__ == '__main__':
     main()
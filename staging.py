@@ -0,0 +1,62 @@
+import os
+
+import resume
+
+# atomic uploads: STOR writes land in a hidden per-user staging area in
+# the same directory tree (same filesystem, so the commit is a pure
+# rename) and become visible only when the transfer completes.  Consumers
+# watching the directory see one rename event for a finished file instead
+# of polling a growing partial.  The staging path is deterministic per
+# user+destination, so a REST resume after a drop reopens the same
+# partial; incomplete uploads keep their staged file and resume sidecar
+
+STAGE_DIR = '.ftpstage'
+
+def staged_path(path, username):
+    head, tail = os.path.split(path)
+    return os.path.join(head, STAGE_DIR, username or 'anonymous', tail)
+
+class StagingFSMixin:
+    def _pending(self, path):
+        # the staged partial for path, or None if no upload is in flight
+        staged = staged_path(path,
+                             getattr(self.cmd_channel, 'username', None))
+        return staged if os.path.exists(staged) else None
+
+    def getsize(self, path):
+        # ftp_STOR validates the REST offset against the destination, but
+        # while the upload is uncommitted the bytes live in the staging
+        # area; answer with the partial's size so resumes line up
+        staged = self._pending(path)
+        return super().getsize(staged if staged is not None else path)
+
+    def lexists(self, path):
+        return self._pending(path) is not None or super().lexists(path)
+
+    def open(self, filename, mode):
+        if 'w' in mode or '+' in mode:
+            staged = staged_path(filename,
+                                 getattr(self.cmd_channel, 'username', None))
+            if '+' in mode and not os.path.exists(staged) \
+                    and os.path.exists(filename):
+                # resuming a file that was already committed: leave it be
+                return super().open(filename, mode)
+            os.makedirs(os.path.dirname(staged), exist_ok=True)
+            if '+' in mode and not os.path.exists(staged):
+                open(staged, 'wb').close()
+            return super().open(staged, mode)
+        return super().open(filename, mode)
+
+def enable(handler):
+    handler.abstracted_fs = type('StagingFS',
+                                 (StagingFSMixin, handler.abstracted_fs), {})
+    previous = handler.on_file_received
+    def on_file_received(self, file):
+        staged = staged_path(file, self.username)
+        try:
+            os.replace(staged, file)  # the commit: one atomic rename
+            resume.discard(staged)
+        except OSError:
+            pass
+        previous(self, file)
+    handler.on_file_received = on_file_received
@@ -0,0 +1,73 @@
+import os
+
+import listcache
+
+# bounded-memory listings: LIST/MLSD of a 3M-entry directory used to
+# materialize every name and formatted line before the first byte went
+# out, spiking RSS by gigabytes per session.  Here directory entries come
+# straight from os.scandir and are formatted in small batches as the data
+# channel drains, so per-listing memory stays a constant regardless of
+# directory size.  Listings that finish under a cap are handed to the
+# listing cache on the way through; bigger ones stream uncached
+
+BATCH = 512
+CACHE_LIMIT = 65536  # entries; beyond this a listing is too big to cache
+
+class LazyListing:
+    # quacks just enough like the list the handler expects: iterable,
+    # joinable, sortable (a no-op: sorting 3M names is the cost we are
+    # here to avoid)
+    def __init__(self, path):
+        self._path = path
+
+    def __iter__(self):
+        with os.scandir(self._path) as it:
+            for entry in it:
+                yield entry.name
+
+    def sort(self, **kwargs):
+        pass
+
+class StreamListFSMixin:
+    def get_list_dir(self, path):
+        if not self.isdir(path):
+            return super().get_list_dir(path)
+        entry = listcache.cache.lookup(path)
+        if entry is not None:
+            return iter(entry.lines)
+        return self._stream_list(path)
+
+    def _stream_list(self, path):
+        lines, names = [], []
+        batch = []
+        def flush(batch):
+            for line in self.format_list(path, batch):
+                if lines is not None:
+                    lines.append(line)
+                yield line
+        with os.scandir(path) as it:
+            for dentry in it:
+                batch.append(dentry.name)
+                if names is not None:
+                    names.append(dentry.name)
+                    if len(names) > CACHE_LIMIT:
+                        lines = names = None
+                if len(batch) >= BATCH:
+                    yield from flush(batch)
+                    batch = []
+        if batch:
+            yield from flush(batch)
+        if names is not None:
+            names.sort()
+            listcache.cache.store(path, lines, names)
+
+    def listdir(self, path):
+        entry = listcache.cache.lookup(path)
+        if entry is not None:
+            return list(entry.names)
+        return LazyListing(path)
+
+def enable(handler):
+    handler.abstracted_fs = type('StreamListFS',
+                                 (StreamListFSMixin,
+                                  handler.abstracted_fs), {})
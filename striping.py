@@ -0,0 +1,76 @@
+# parallel-stream downloads: a client opens several control+data sessions
+# and fetches disjoint byte ranges of one file concurrently, so per-file
+# throughput scales with streams instead of being capped by TLS record
+# processing on a single connection.  The coordination command is RANG
+# (draft-bryan-ftp-range): "RANG start end" arms a byte range consumed by
+# the next RETR, which then seeks to start and stops after end
+
+class _CappedReader:
+    # no fileno(): keeps the transfer on the buffered path, where the cap
+    # is enforced, instead of sendfile-to-EOF
+    def __init__(self, fh, limit):
+        self._fh = fh
+        self._limit = limit  # absolute exclusive end offset
+        self.name = getattr(fh, 'name', None)
+        self.closed = False
+
+    def read(self, size=-1):
+        left = self._limit - self._fh.tell()
+        if left <= 0:
+            return b''
+        if size is None or size < 0 or size > left:
+            size = left
+        return self._fh.read(size)
+
+    def seek(self, offset, whence=0):
+        self._fh.seek(offset, whence)
+
+    def tell(self):
+        return self._fh.tell()
+
+    def close(self):
+        if not self.closed:
+            self._fh.close()
+            self.closed = True
+
+class StripingFTPHandlerMixin:
+    _range_limit = None
+
+    def ftp_RANG(self, line):
+        try:
+            start, end = map(int, line.split())
+        except ValueError:
+            self.respond('501 Syntax: RANG <SP> start end.')
+            return
+        if start < 0 or end < start:
+            self.respond('501 Invalid byte range.')
+            return
+        self._range_limit = (start, end)
+        self.respond('350 Restarting at %d, ending at %d.' % (start, end))
+
+    def ftp_RETR(self, file):
+        rng, self._range_limit = self._range_limit, None
+        if rng is None:
+            return super().ftp_RETR(file)
+        start, end = rng
+        self._restart_position = start
+        real_open = self.fs.open
+        def capped_open(filename, mode):
+            return _CappedReader(real_open(filename, mode), end + 1)
+        self.fs.open = capped_open
+        try:
+            return super().ftp_RETR(file)
+        finally:
+            self.fs.open = real_open
+
+def enable(handler):
+    proto_cmds = dict(handler.proto_cmds)
+    # perm=None: the argument is a byte range, not a path, so the
+    # dispatcher must not rewrite it through ftp2fs; read permission is
+    # checked by the RETR that consumes the range
+    proto_cmds['RANG'] = dict(
+        perm=None, auth=True, arg=True,
+        help='Syntax: RANG <SP> start end (byte range for next RETR).')
+    return type('StripingFTPHandler',
+                (StripingFTPHandlerMixin, handler),
+                {'proto_cmds': proto_cmds})
@@ -0,0 +1,26 @@
+from OpenSSL import SSL
+
+# shared TLS context with server-side session caching: reconnecting FTPS
+# clients resume with an abbreviated handshake instead of paying the full
+# RSA exchange on every control connection
+
+_CACHE_SIZE = 20480
+_TIMEOUT = 7200  # seconds a cached session stays resumable
+
+def make_context(certfile, keyfile=None, protocol=SSL.SSLv23_METHOD):
+    ctx = SSL.Context(protocol)
+    ctx.set_options(SSL.OP_NO_SSLv2 | SSL.OP_NO_SSLv3)
+    ctx.use_certificate_chain_file(certfile)
+    ctx.use_privatekey_file(keyfile or certfile)
+    ctx.set_session_cache_mode(SSL.SESS_CACHE_SERVER)
+    ctx.set_session_id(b'sslftp')
+    ctx.set_timeout(_TIMEOUT)
+    try:
+        SSL._lib.SSL_CTX_sess_set_cache_size(ctx._context, _CACHE_SIZE)
+    except AttributeError:
+        pass
+    return ctx
+
+def enable(handler):
+    handler.ssl_context = make_context(handler.certfile, handler.keyfile)
+    return handler.ssl_context
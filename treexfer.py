@@ -0,0 +1,103 @@
+import os
+import tarfile
+
+# server-side tree download: XTAR <dir> streams a whole subtree as one
+# tar over a single data connection, so mirroring 100k files costs one
+# PASV cycle instead of 100k command round trips.  The archive is
+# generated on the fly: headers and 64KB file chunks are produced only as
+# the data channel drains, so memory stays bounded no matter how big the
+# tree is.  The command runs under the same 'r' permission checks as RETR
+
+CHUNK = 64 * 1024
+
+class TarStreamProducer:
+    def __init__(self, root):
+        self._buf = bytearray()
+        self._tar = tarfile.open(mode='w|', fileobj=self)
+        self._walker = self._walk(root)
+
+    # tarfile's stream writer lands here
+    def write(self, data):
+        self._buf += data
+        return len(data)
+
+    def _walk(self, root):
+        base = os.path.basename(root.rstrip(os.sep)) or 'tree'
+        for dirpath, dirnames, filenames in os.walk(root):
+            rel = os.path.relpath(dirpath, root)
+            arcdir = base if rel == os.curdir else os.path.join(base, rel)
+            try:
+                self._tar.addfile(self._tar.gettarinfo(dirpath, arcdir))
+            except OSError:
+                continue
+            yield
+            for name in filenames:
+                path = os.path.join(dirpath, name)
+                try:
+                    info = self._tar.gettarinfo(
+                        path, os.path.join(arcdir, name))
+                except OSError:
+                    continue
+                if not info.isreg():
+                    self._tar.addfile(info)
+                    yield
+                    continue
+                self._tar.addfile(info)
+                left = info.size
+                try:
+                    with open(path, 'rb') as f:
+                        while left > 0:
+                            chunk = f.read(min(CHUNK, left))
+                            if not chunk:
+                                break
+                            left -= len(chunk)
+                            self._tar.fileobj.write(chunk)
+                            yield
+                except OSError:
+                    pass
+                if left:
+                    # unreadable or shrank mid-read: pad to the advertised
+                    # size so the archive stays well-formed
+                    self._tar.fileobj.write(b'\0' * left)
+                pad = -info.size % tarfile.BLOCKSIZE
+                if pad:
+                    self._tar.fileobj.write(b'\0' * pad)
+                blocks, rem = divmod(info.size, tarfile.BLOCKSIZE)
+                self._tar.offset += (blocks + (1 if rem else 0)) * \
+                    tarfile.BLOCKSIZE
+                yield
+
+    def more(self):
+        while len(self._buf) < CHUNK and self._walker is not None:
+            try:
+                next(self._walker)
+            except StopIteration:
+                self._walker = None
+                self._tar.close()
+        # addfile() appends every TarInfo to tar.members; on the 100k+
+        # file trees this command exists for that's the only thing that
+        # grows, so drop them as we go
+        if self._tar.members:
+            del self._tar.members[:]
+        data = bytes(self._buf[:CHUNK])
+        del self._buf[:CHUNK]
+        return data
+
+class TreeFTPHandlerMixin:
+    def ftp_XTAR(self, path):
+        # the dispatcher already translated the argument (perm='r'), so
+        # path is a real filesystem path here, like ftp_RETR's
+        if not self.fs.isdir(path):
+            self.respond('550 %s is not a directory.' %
+                         self.fs.fs2ftp(path))
+            return
+        producer = TarStreamProducer(path)
+        self.push_dtp_data(producer, isproducer=True, cmd='XTAR')
+
+def enable(handler):
+    proto_cmds = dict(handler.proto_cmds)
+    proto_cmds['XTAR'] = dict(
+        perm='r', auth=True, arg=True,
+        help='Syntax: XTAR <SP> dir-name (stream directory as tar).')
+    return type('TreeFTPHandler', (TreeFTPHandlerMixin, handler),
+                {'proto_cmds': proto_cmds})
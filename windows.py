@@ -1,13 +1,31 @@
+import os
 from pyftpdlib.servers import FTPServer
-from pyftpdlib.authorizers import DummyAuthorizer
 from pyftpdlib.handlers import TLS_FTPHandler
+import hotreload
+import pools
+import hashauth
+import zerocopy
+import portpool
+import shaper
+import resume
+import metrics
+import shared
+import binlog
+import pipeline
+import writebehind
+import checksum
+import fastenc
+import treexfer
+import accounting
 def main():
-    authorizer = DummyAuthorizer()
+    #hashed file-backed store; FTP_USERS_DB points at the big user db
+    authorizer = hashauth.HashedAuthorizer(os.environ.get('FTP_USERS_DB'))
     authorizer.add_user('wangyifan', 'helloUSA', '..', perm='elradfmwMT')
     authorizer.add_user('wangyifan2','helloUSA','/home',perm='elradfmwMT')
     #authorizer.add_anonymous('.')
     handler = TLS_FTPHandler
-    handler.encoding = 'gbk'
+    #gbk with an ASCII bypass and memoized non-ASCII encodings
+    handler.encoding = fastenc.register('gbk')
     handler.certfile = 'server.crt'
     handler.keyfile = 'server.key'
     handler.authorizer = authorizer
@@ -15,8 +33,36 @@ def main():
     handler.tls_control_required = False
     handler.tls_data_required = False
     #handler.masquerade_address = '185.161.70.200'
-    handler.passive_ports = range(3000,4000)
-    server = FTPServer(('0.0.0.0', 21), handler)
-    server.serve_forever()
+    #O(1) free-list allocator over the old range(3000,4000)
+    pool = portpool.enable(handler, range(3000,4000))
+    #zero-copy sendfile for plaintext data connections (TLS falls back to buffered)
+    zerocopy.enable(handler)
+    #token buckets: bulk mirror user capped so interactive sessions keep headroom
+    bank = shaper.enable(handler)
+    bank.set_user_limit('wangyifan2', send=80*1024*1024, recv=80*1024*1024)
+    #chunk-checksummed sidecar index so REST resumes skip full re-reads
+    resume.enable(handler)
+    #coalesce STOR data into 8MB sequential writes, fsync before 226
+    writebehind.enable(handler)
+    #counters + loop-lag sampler; snapshot via the unix stats socket
+    metrics.enable(handler, pool=pool, sock_path='/tmp/ftpstats-21.sock')
+    #both instances share one /dev/shm board: global session cap per user
+    board = shared.enable(handler, session_limit=8)
+    #per-transfer records into an mmap'd ring; dump with binlog.py
+    binlog.enable(handler, '/var/tmp/ftp-windows.ring')
+    #persistent passive listener for back-to-back small-file transfers
+    handler = pipeline.enable(handler)
+    #XCRC/XMD5/XSHA256 served from digests hashed during STOR
+    handler = checksum.enable(handler)
+    #XTAR streams a directory subtree as one tar over the data channel
+    handler = treexfer.enable(handler)
+    #O(1) quota checks from an incrementally-maintained ledger
+    ledger, handler = accounting.enable(handler, '/var/tmp/ftp-ledger.json')
+    ledger.quotas['wangyifan2'] = 500*1024*1024*1024
+    #freeze startup state out of the GC and raise gen-0 threshold
+    pools.enable()
+    #FTP_WORKERS=N preforks N accept loops; SIGUSR2 reloads with zero downtime
+    hotreload.serve_forever(('0.0.0.0', 21), handler,
+                            workers_count=int(os.environ.get('FTP_WORKERS', '1')))
 if __name__ == '__main__':
     main()
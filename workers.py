@@ -0,0 +1,77 @@
+import os
+import socket
+import signal
+from pyftpdlib.servers import FTPServer
+
+# prefork worker pool: every worker binds its own SO_REUSEPORT listening
+# socket on the same address and runs a private accept loop, so the kernel
+# load-balances connections across cores instead of one loop pinning a core
+
+worker_pids = []  # populated in the master; used by hotreload to drain
+
+# which serving process this is; set before the postfork hooks run so
+# subsystems can partition shared resources (e.g. the passive port range)
+worker_index = 0
+worker_count = 1
+
+# threads do not survive fork(), so anything that owns one (log writers,
+# flushers, indexers, stats sockets) registers a starter here instead of
+# spawning at import/enable time; the hooks run in every serving process
+# right before its accept loop starts
+_postfork_hooks = []
+
+def postfork(fn):
+    _postfork_hooks.append(fn)
+
+def _run_postfork_hooks():
+    for fn in _postfork_hooks:
+        fn()
+
+def _bind_reuseport(address):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if hasattr(socket, 'SO_REUSEPORT'):
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+    sock.bind(address)
+    sock.listen(256)
+    sock.setblocking(False)
+    return sock
+
+def serve_forever(address, handler, workers=None, server_class=FTPServer,
+                  child_setup=None):
+    workers = workers or os.cpu_count() or 1
+    if workers <= 1 or not hasattr(socket, 'SO_REUSEPORT'):
+        server = server_class(_bind_reuseport(address), handler)
+        _run_postfork_hooks()
+        if child_setup is not None:
+            child_setup(server)
+        server.serve_forever()
+        return
+    del worker_pids[:]
+    for index in range(workers):
+        pid = os.fork()
+        if pid == 0:
+            global worker_index, worker_count
+            worker_index, worker_count = index, workers
+            server = server_class(_bind_reuseport(address), handler)
+            _run_postfork_hooks()
+            if child_setup is not None:
+                child_setup(server)
+            try:
+                server.serve_forever()
+            finally:
+                os._exit(0)
+        worker_pids.append(pid)
+    def _shutdown(signum, frame):
+        for pid in worker_pids:
+            try:
+                os.kill(pid, signal.SIGTERM)
+            except OSError:
+                pass
+    signal.signal(signal.SIGTERM, _shutdown)
+    signal.signal(signal.SIGINT, _shutdown)
+    for pid in worker_pids:
+        try:
+            os.waitpid(pid, 0)
+        except OSError:
+            break
@@ -0,0 +1,147 @@
+import os
+import threading
+from collections import deque
+
+import pools
+
+# upload write-behind: incoming STOR data is coalesced into large aligned
+# blocks in memory and flushed by a small background writer pool, so the
+# RAID controller sees a few big sequential writes per file instead of a
+# storm of small random ones.  close() drains the queue and fsyncs before
+# returning, which puts a durability barrier in front of the 226 reply
+
+BLOCK = 8 * 1024 * 1024
+WORKERS = 2
+
+_arenas = pools.pool(BLOCK)
+
+class _WriterPool:
+    def __init__(self, workers=WORKERS):
+        self._ready = deque()  # files with pending blocks
+        self._cond = threading.Condition()
+        self._threads = []
+        self._workers = workers
+
+    def _spawn(self):
+        while len(self._threads) < self._workers:
+            t = threading.Thread(target=self._run, daemon=True)
+            t.start()
+            self._threads.append(t)
+
+    def schedule(self, wbfile):
+        with self._cond:
+            self._spawn()
+            if not wbfile._scheduled:
+                wbfile._scheduled = True
+                self._ready.append(wbfile)
+                self._cond.notify()
+
+    def _run(self):
+        while True:
+            with self._cond:
+                while not self._ready:
+                    self._cond.wait()
+                wbfile = self._ready.popleft()
+            wbfile._drain()
+
+pool = _WriterPool()
+
+class WriteBehindFile:
+    def __init__(self, fh):
+        self._fh = fh
+        self.name = getattr(fh, 'name', None)
+        self.closed = False
+        self._buf = _arenas.acquire()
+        self._fill = 0
+        self._pending = deque()
+        self._scheduled = False
+        self._error = None
+        self._lock = threading.Lock()
+        self._idle = threading.Condition(self._lock)
+
+    def write(self, data):
+        if self._error is not None:
+            raise self._error
+        view = memoryview(data)
+        while view:
+            take = min(BLOCK - self._fill, len(view))
+            self._buf[self._fill:self._fill + take] = view[:take]
+            self._fill += take
+            view = view[take:]
+            if self._fill == BLOCK:
+                self._flush_buffer()
+        return len(data)
+
+    # one worker drains a file at a time, so blocks land in order
+    def _drain(self):
+        while True:
+            with self._lock:
+                if not self._pending:
+                    self._scheduled = False
+                    self._idle.notify_all()
+                    return
+                block, used = self._pending.popleft()
+            try:
+                self._fh.write(memoryview(block)[:used])
+                _arenas.release(block)
+            except OSError as err:
+                with self._lock:
+                    self._error = err
+                    self._pending.clear()
+                    self._scheduled = False
+                    self._idle.notify_all()
+                return
+
+    def _wait_drained(self):
+        with self._lock:
+            while self._scheduled:
+                self._idle.wait()
+        if self._error is not None:
+            raise self._error
+
+    def seek(self, offset, whence=0):
+        # resumes seek before writing; push buffered data out first
+        self._flush_buffer()
+        self._wait_drained()
+        self._fh.seek(offset, whence)
+
+    def tell(self):
+        return self._fh.tell() + self._fill
+
+    def _flush_buffer(self):
+        if self._fill:
+            block, self._buf = self._buf, _arenas.acquire()
+            with self._lock:
+                self._pending.append((block, self._fill))
+            self._fill = 0
+            pool.schedule(self)
+
+    def close(self):
+        if self.closed:
+            return
+        self._flush_buffer()
+        try:
+            self._wait_drained()
+            try:
+                os.fsync(self._fh.fileno())
+            except (OSError, AttributeError):
+                pass
+        finally:
+            self._fh.close()
+            self.closed = True
+            _arenas.release(self._buf)
+
+    def __getattr__(self, name):
+        return getattr(self._fh, name)
+
+class WriteBehindFSMixin:
+    def open(self, filename, mode):
+        fh = super().open(filename, mode)
+        if 'w' in mode or 'a' in mode or '+' in mode:
+            return WriteBehindFile(fh)
+        return fh
+
+def enable(handler):
+    handler.abstracted_fs = type('WriteBehindFS',
+                                 (WriteBehindFSMixin,
+                                  handler.abstracted_fs), {})